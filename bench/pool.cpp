@@ -0,0 +1,94 @@
+// Compares resource_pool behind a mutex with concurrent_resource_pool under contention.
+// Usage: agrb_bench_pool [threads] [iterations]
+#include <agrb/concurrent_pool.hpp>
+#include <agrb/pool.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace agrb;
+
+struct dummy_alloc
+{
+    std::atomic<u64> next{1};
+
+    void alloc(u64 *pData, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) pData[i] = next++;
+    }
+
+    void release(u64 &) {}
+};
+
+struct locked_pool
+{
+    resource_pool<u64, dummy_alloc> pool;
+    std::mutex lock;
+
+    void request(u64 *pData, size_t size, u32 *pHandles)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pool.request(pData, size, pHandles);
+    }
+
+    void release(const u32 *pHandles, size_t size)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pool.release(pHandles, size);
+    }
+};
+
+struct lock_free_pool
+{
+    concurrent_resource_pool<u64, dummy_alloc> pool;
+
+    void request(u64 *pData, size_t size, u32 *pHandles) { pool.request(pData, size, pHandles); }
+
+    void release(const u32 *pHandles, size_t size)
+    {
+        if (size == 1)
+            pool.release(pHandles[0]);
+        else
+            pool.release(pHandles, size);
+    }
+};
+
+template <typename Pool>
+double run(int thread_count, int iterations, size_t span)
+{
+    Pool pool;
+    pool.pool.allocate(thread_count * span);
+    std::atomic<bool> start{false};
+    acul::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+        threads.emplace_back([&]() {
+            u64 values[16];
+            u32 handles[16];
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (int i = 0; i < iterations; ++i)
+            {
+                pool.request(values, span, handles);
+                pool.release(handles, span);
+            }
+        });
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto &thread : threads) thread.join();
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    auto ops = static_cast<double>(thread_count) * iterations * span;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ops;
+}
+
+int main(int argc, char **argv)
+{
+    int thread_count = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 200000;
+    if (thread_count < 1) thread_count = 1;
+
+    std::printf("%-8s %-6s %-20s %-20s\n", "threads", "span", "mutex ns/op", "lock-free ns/op");
+    for (int threads = 1; threads <= thread_count; threads *= 2)
+        for (size_t span : {size_t(1), size_t(8)})
+            std::printf("%-8d %-6zu %-20.2f %-20.2f\n", threads, span, run<locked_pool>(threads, iterations, span),
+                        run<lock_free_pool>(threads, iterations, span));
+    return 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include "utils/buffer.hpp"
+
+namespace agrb
+{
+    /// @brief Passes of a frame during which a resource holds data, both ends inclusive
+    struct alias_lifetime
+    {
+        u32 first_pass;
+        u32 last_pass;
+
+        bool overlaps(const alias_lifetime &other) const
+        {
+            return first_pass <= other.last_pass && other.first_pass <= last_pass;
+        }
+    };
+
+    struct aliasing_stats
+    {
+        u32 resources = 0;
+        u32 blocks = 0;
+        /// Memory the resources would take with an allocation each
+        vk::DeviceSize requested_bytes = 0;
+        /// Memory actually allocated for the shared blocks
+        vk::DeviceSize allocated_bytes = 0;
+    };
+
+    /**
+     * @brief Places transient resources whose lifetimes do not overlap into shared device memory.
+     *
+     * Attachments and scratch buffers are declared with the passes of the frame that use them. build() creates
+     * them, packs resources with disjoint lifetimes into the same memory ranges and binds them there.
+     * The declared fb_image and buffer objects receive the handles with a null VmaAllocation: they are destroyed
+     * as usual with destroy_fb_image() and destroy_buffer(), which then only destroy the handle, while the memory
+     * belongs to the allocator until release().
+     *
+     * The contents of an aliased resource are undefined at its first pass: images must be transitioned from
+     * eUndefined, and the pass must be ordered after the last pass of the resources it overlaps in memory.
+     * Declarations are kept until release(); after a resize, destroy the resources, release and declare again.
+     */
+    class aliasing_allocator
+    {
+    public:
+        explicit aliasing_allocator(device &device) : _device(device) {}
+
+        aliasing_allocator(const aliasing_allocator &) = delete;
+        aliasing_allocator &operator=(const aliasing_allocator &) = delete;
+
+        ~aliasing_allocator() { release(); }
+
+        /// @brief Declare a transient image. The image is created by build()
+        AGRB_EXPORT void declare(fb_image &image, const vk::ImageCreateInfo &image_info, alias_lifetime lifetime);
+
+        /// @brief Declare a transient buffer. The buffer is created by build()
+        AGRB_EXPORT void declare(buffer &buffer, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                                 alias_lifetime lifetime);
+
+        /**
+         * @brief Create the declared resources and bind them to shared memory
+         * @param alloc_info Allocation info of the shared blocks. The usage must not be one of the AUTO usages
+         * @return False if a resource or a block could not be created. Nothing is left allocated then
+         */
+        AGRB_EXPORT bool build(const VmaAllocationCreateInfo &alloc_info =
+                                   make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {},
+                                                   vk::MemoryPropertyFlagBits::eDeviceLocal, 1.0f));
+
+        /// @brief Free the shared memory and forget the declarations. Built resources must be destroyed first
+        AGRB_EXPORT void release();
+
+        const aliasing_stats &stats() const { return _stats; }
+
+    private:
+        struct declared_resource
+        {
+            void *owner;
+            bool is_image;
+            vk::ImageCreateInfo image_info;
+            vk::BufferCreateInfo buffer_info;
+            alias_lifetime lifetime;
+            vk::Image image;
+            vk::Buffer vk_buffer;
+            vk::MemoryRequirements requirements;
+            u32 block;
+            vk::DeviceSize offset;
+        };
+
+        struct memory_block
+        {
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            u32 memory_type_bits = ~0u;
+            vk::DeviceSize size = 0;
+            vk::DeviceSize alignment = 1;
+            acul::vector<u32> resources;
+        };
+
+        device &_device;
+        acul::vector<declared_resource> _resources;
+        acul::vector<memory_block> _blocks;
+        aliasing_stats _stats;
+
+        void place(u32 index);
+        void discard();
+    };
+} // namespace agrb
@@ -1,8 +1,63 @@
 #pragma once
+#include <acul/memory/smart_ptr.hpp>
+#include <algorithm>
 #include "device.hpp"
 
 namespace agrb
 {
+    /**
+     * @brief Written intervals of a mapped buffer in non-coherent memory.
+     * Intervals are collected by write_to_buffer() and friends and merged into as few ranges as possible,
+     * aligned to nonCoherentAtomSize, when they are flushed with flush_dirty_ranges().
+     */
+    struct dirty_range_tracker
+    {
+        struct range
+        {
+            vk::DeviceSize begin;
+            vk::DeviceSize end;
+        };
+
+        vk::DeviceSize atom_size = 1;
+        /// Coherent memory needs no flushes, mark() is a no-op then
+        bool coherent = true;
+        acul::vector<range> ranges;
+
+        void mark(vk::DeviceSize offset, vk::DeviceSize size)
+        {
+            if (coherent || size == 0) return;
+            // Sequential writes are the common case, extend the last interval instead of growing the list.
+            if (!ranges.empty() && ranges.back().end >= offset && ranges.back().begin <= offset)
+                ranges.back().end = std::max(ranges.back().end, offset + size);
+            else
+                ranges.push_back({offset, offset + size});
+        }
+
+        /// @brief Align the intervals to the atom size and coalesce the overlapping and adjacent ones
+        /// @param limit Size of the tracked range. Aligned ends are clamped to it
+        void merge(vk::DeviceSize limit)
+        {
+            if (ranges.size() < 2 && atom_size <= 1) return;
+            for (auto &r : ranges)
+            {
+                r.begin -= r.begin % atom_size;
+                r.end = std::min((r.end + atom_size - 1) / atom_size * atom_size, limit);
+            }
+            std::sort(ranges.begin(), ranges.end(), [](const range &a, const range &b) { return a.begin < b.begin; });
+            size_t last = 0;
+            for (size_t i = 1; i < ranges.size(); ++i)
+            {
+                if (ranges[i].begin <= ranges[last].end)
+                    ranges[last].end = std::max(ranges[last].end, ranges[i].end);
+                else
+                    ranges[++last] = ranges[i];
+            }
+            ranges.resize(last + 1);
+        }
+
+        bool empty() const { return ranges.empty(); }
+    };
+
     struct buffer
     {
         u32 instance_count = 0;
@@ -11,6 +66,15 @@ namespace agrb
         VmaAllocation allocation = VK_NULL_HANDLE;
         vk::DeviceSize alignment_size = 0;
         vk::DeviceSize buffer_size = 0;
+        /// Offset of the buffer range inside vk_buffer. Non-zero for ranges sub-allocated from a larger buffer
+        vk::DeviceSize offset = 0;
+        /// Optional dirty range tracking, see track_dirty_ranges(). Copies of the buffer share the tracker
+        acul::shared_ptr<dirty_range_tracker> dirty_ranges;
+        /// GPU address of vk_buffer. Set for buffers created with eShaderDeviceAddress
+        vk::DeviceAddress address = 0;
+
+        /// @brief GPU address of the buffer range, e.g. for push constants. Zero if the buffer has no address
+        vk::DeviceAddress device_address() const { return address ? address + offset : 0; }
     };
 
     struct managed_buffer final : buffer
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <acul/hash/hashmap.hpp>
+#include <mutex>
+#include "utils/buffer.hpp"
+
+namespace agrb
+{
+    struct buffer_arena_create_info
+    {
+        /// Size of each VkBuffer backing the arena. Larger requests get a block of their own
+        vk::DeviceSize block_size = 16u << 20;
+        vk::BufferUsageFlags usage;
+        VmaAllocationCreateInfo alloc_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {});
+        /// Keep host visible blocks mapped so that write_to_buffer() works on every suballocation
+        bool mapped = false;
+
+        buffer_arena_create_info &set_block_size(vk::DeviceSize value)
+        {
+            block_size = value;
+            return *this;
+        }
+
+        buffer_arena_create_info &set_usage(vk::BufferUsageFlags value)
+        {
+            usage = value;
+            return *this;
+        }
+
+        buffer_arena_create_info &set_alloc_info(const VmaAllocationCreateInfo &value)
+        {
+            alloc_info = value;
+            return *this;
+        }
+
+        buffer_arena_create_info &set_mapped(bool value)
+        {
+            mapped = value;
+            return *this;
+        }
+    };
+
+    struct buffer_arena_stats
+    {
+        size_t blocks = 0;
+        vk::DeviceSize block_bytes = 0;
+        vk::DeviceSize used_bytes = 0;
+        size_t allocations = 0;
+    };
+
+    /**
+     * @brief Hands out ranges of a few large VkBuffers instead of creating a buffer per resource.
+     *
+     * Ranges are placed with a VmaVirtualBlock per backing buffer. A range is a regular buffer whose offset is the
+     * position inside vk_buffer and whose allocation is the allocation of the backing buffer, so write_to_buffer(),
+     * flush_buffer(), invalidate_buffer(), copy_buffer() and get_descriptor_info() work on it unchanged.
+     * Ranges must be returned with release(), never with destroy_buffer().
+     */
+    class buffer_arena
+    {
+    public:
+        buffer_arena() = default;
+
+        buffer_arena(const buffer_arena &) = delete;
+        buffer_arena &operator=(const buffer_arena &) = delete;
+
+        ~buffer_arena() { destroy(); }
+
+        /// @brief Initialize the arena. Blocks are created on demand
+        AGRB_EXPORT void create(device &device, const buffer_arena_create_info &create_info);
+
+        /// @brief Destroy all blocks. Every range must have been released and must not be in use by the GPU
+        AGRB_EXPORT void destroy();
+
+        /**
+         * @brief Allocate a range
+         * @param size Size of the range in bytes
+         * @param out Destination buffer
+         * @param alignment Alignment of the range offset. Zero uses the minimal offset alignment required
+         * by the arena usage flags
+         * @return True on success, false if a new block could not be allocated
+         */
+        AGRB_EXPORT bool allocate(vk::DeviceSize size, buffer &out, vk::DeviceSize alignment = 0);
+
+        /// @brief Return a range to the arena. Empty blocks beyond the first one are destroyed
+        AGRB_EXPORT void release(buffer &range);
+
+        AGRB_EXPORT buffer_arena_stats stats() const;
+
+        /// @brief Minimal offset alignment of the arena ranges
+        vk::DeviceSize alignment() const { return _alignment; }
+
+    private:
+        struct block
+        {
+            buffer data;
+            VmaVirtualBlock virtual_block = VK_NULL_HANDLE;
+            acul::hashmap<vk::DeviceSize, VmaVirtualAllocation> ranges;
+            vk::DeviceSize used = 0;
+        };
+
+        device *_device = nullptr;
+        buffer_arena_create_info _create_info;
+        vk::DeviceSize _alignment = 1;
+        acul::vector<block *> _blocks;
+        mutable std::mutex _lock;
+
+        block *create_block(vk::DeviceSize size);
+        void destroy_block(block *block);
+    };
+} // namespace agrb
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <acul/functional/unique_function.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "device.hpp"
+
+namespace agrb
+{
+    /**
+     * @brief Command pools owned by individual recording workers.
+     *
+     * A vk::CommandPool must not be used by several threads at once, so a single pool per queue family serializes
+     * all command recording. The registry creates one pool for every (worker, frame) pair of a queue family; each
+     * worker records into its own pool and a frame's pools are reset together once the GPU has finished that frame.
+     * The set of pools is fixed at creation, so acquiring a pool does not need any locking.
+     * The registry also keeps a recording thread per additional worker, started on the first run_workers() call
+     * and parked between calls, so parallel recording does not create threads every frame.
+     */
+    class command_pool_registry
+    {
+    public:
+        command_pool_registry() = default;
+
+        command_pool_registry(const command_pool_registry &) = delete;
+        command_pool_registry &operator=(const command_pool_registry &) = delete;
+
+        ~command_pool_registry() { assert(_pools.empty() && "destroy() must be called before the device is gone"); }
+
+        /**
+         * @brief Create the command pools
+         * @param device Device owning the pools
+         * @param queue Queue family the recorded command buffers are submitted to
+         * @param workers Number of threads recording concurrently
+         * @param frames Number of frames in flight
+         * @param primary Number of primary command buffers preallocated in every pool
+         * @param secondary Number of secondary command buffers preallocated in every pool
+         */
+        AGRB_EXPORT void create(device &device, const queue_family_info &queue, u32 workers, u32 frames,
+                                size_t primary, size_t secondary);
+
+        /// @brief Join the recording threads and destroy the command pools
+        AGRB_EXPORT void destroy();
+
+        /// @brief Get the pool of a worker for the specified frame.
+        /// Only the worker itself may use the returned pool until the frame is reset.
+        command_pool &acquire(u32 worker, u32 frame)
+        {
+            assert(worker < _workers && frame < _frames);
+            return _pools[frame * _workers + worker];
+        }
+
+        /// @brief Reset all pools of a frame. The GPU must have finished executing the frame's command buffers
+        AGRB_EXPORT void reset(u32 frame);
+
+        /// @brief Trim the pools of a frame, typically right after reset()
+        /// @return Number of freed command buffers
+        size_t trim(u32 frame, const pool_shrink_policy &policy)
+        {
+            size_t released = 0;
+            for (u32 worker = 0; worker < _workers; ++worker)
+                released += acquire(worker, frame).trim(_device->vk_device, _device->loader, policy);
+            return released;
+        }
+
+        /**
+         * @brief Run a job once for every worker in [0, count) and wait for all of them.
+         * Worker 0 runs on the calling thread, the others on the registry's recording threads.
+         * Must not be called concurrently on the same registry.
+         * @param count Number of workers, at most workers()
+         * @param job Job receiving the worker index. Must not throw
+         */
+        AGRB_EXPORT void run_workers(u32 count, acul::unique_function<void(u32)> &job);
+
+        u32 workers() const { return _workers; }
+
+        u32 frames() const { return _frames; }
+
+        bool valid() const { return !_pools.empty(); }
+
+    private:
+        device *_device = nullptr;
+        u32 _workers = 0;
+        u32 _frames = 0;
+        // Never resized after create(): the buffer allocators keep pointers to the pool handles.
+        acul::vector<command_pool> _pools;
+
+        acul::vector<std::thread> _threads;
+        std::mutex _lock;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        acul::unique_function<void(u32)> *_job = nullptr;
+        u32 _job_workers = 0;
+        u32 _pending = 0;
+        u64 _generation = 0;
+        bool _stop = false;
+
+        void worker_loop(u32 worker);
+    };
+
+    /// @brief Records commands into a secondary command buffer that has already begun
+    using secondary_record_task = acul::unique_function<void(vk::CommandBuffer)>;
+
+    /**
+     * @brief Record secondary command buffers on several threads and execute them from a primary command buffer.
+     *
+     * Tasks are split into contiguous ranges, one per worker of the registry, and recorded through
+     * command_pool_registry::run_workers(); worker 0 runs on the calling thread.
+     * Every task gets its own secondary command buffer, and the buffers are executed in task order, so the result
+     * does not depend on scheduling. The secondary buffers stay owned by the frame's pools and become reusable on
+     * the next command_pool_registry::reset() of that frame.
+     *
+     * @param registry Registry providing a pool per worker
+     * @param frame Frame whose pools are used
+     * @param primary Primary command buffer that is recording
+     * @param inheritance Inheritance info of the secondary buffers. If a render pass is set, the buffers are begun
+     * with vk::CommandBufferUsageFlagBits::eRenderPassContinue
+     * @param tasks Recording tasks
+     * @param loader Dispatch loader
+     */
+    AGRB_EXPORT void record_secondary_parallel(command_pool_registry &registry, u32 frame, vk::CommandBuffer primary,
+                                               const vk::CommandBufferInheritanceInfo &inheritance,
+                                               acul::vector<secondary_record_task> &tasks,
+                                               vk::DispatchLoaderDynamic &loader);
+} // namespace agrb
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <acul/memory/alloc.hpp>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "pool.hpp"
+
+namespace agrb
+{
+    /**
+     * @brief Thread-safe variant of resource_pool with the same allocation policy interface.
+     *
+     * Released slots go to a cache shard picked by the hash of the calling thread id, so threads mostly touch
+     * their own shard. Shards that grow past shard_limit spill into a shared overflow list, and a thread whose
+     * shard is empty takes from the overflow list, then from the other shards. All lists are lock-free Treiber
+     * stacks of slot indices with a tagged head against ABA. Only growing the pool takes a mutex, since it calls
+     * Alloc::alloc and publishes new storage.
+     *
+     * Slots live in fixed-size chunks that are never moved, so handles and values stay valid until destroy().
+     */
+    template <typename T, typename Alloc>
+    class concurrent_resource_pool
+    {
+    public:
+        using handle = u32;
+        static constexpr handle invalid_handle = UINT32_MAX;
+        static constexpr size_t shard_count = 16;
+        static constexpr size_t shard_limit = 32;
+        static constexpr size_t chunk_size = 64;
+        static constexpr size_t max_chunks = 4096;
+
+        Alloc allocator;
+
+        concurrent_resource_pool() = default;
+
+        concurrent_resource_pool(const concurrent_resource_pool &) = delete;
+        concurrent_resource_pool &operator=(const concurrent_resource_pool &) = delete;
+
+        ~concurrent_resource_pool() { release_storage(); }
+
+        /// @brief Preallocate resources. Not thread-safe
+        void allocate(size_t size)
+        {
+            if (size == 0) return;
+            grow(size, nullptr, nullptr);
+        }
+
+        /// @brief Release every resource through the allocation policy. Not thread-safe
+        void destroy()
+        {
+            size_t capacity = _capacity.load(std::memory_order_acquire);
+            for (size_t i = 0; i < capacity; ++i) allocator.release(slot(static_cast<handle>(i)).value);
+            release_storage();
+        }
+
+        /**
+         * @brief Request resources from the pool. Thread-safe
+         * @param pData Destination of the resources
+         * @param size Number of resources
+         * @param pHandles Optional destination of the handles used to release the resources
+         */
+        void request(T *pData, size_t size, handle *pHandles = nullptr)
+        {
+            size_t taken = 0;
+            handle local[chunk_size];
+            while (taken < size)
+            {
+                size_t batch = std::min(size - taken, chunk_size);
+                handle *ids = pHandles ? pHandles + taken : local;
+                size_t count = _shards[shard_index()].pop(*this, ids, batch);
+                if (count == 0) count = _overflow.pop(*this, ids, batch);
+                if (count == 0) count = steal(ids, batch);
+                if (count == 0) break;
+                for (size_t i = 0; i < count; ++i) pData[taken + i] = slot(ids[i]).value;
+                taken += count;
+            }
+            if (taken < size) grow(size - taken, pData + taken, pHandles ? pHandles + taken : nullptr);
+        }
+
+        /// @brief Return a resource by its handle. Thread-safe
+        void release(handle id)
+        {
+            auto &own = _shards[shard_index()];
+            if (own.count.load(std::memory_order_relaxed) < shard_limit)
+                own.push(*this, id, id, 1);
+            else
+                _overflow.push(*this, id, id, 1);
+        }
+
+        /// @brief Return a span of handles with a single list update. Thread-safe
+        void release(const handle *pHandles, size_t size)
+        {
+            if (size == 0) return;
+            for (size_t i = 0; i + 1 < size; ++i)
+                slot(pHandles[i]).next.store(pHandles[i + 1], std::memory_order_relaxed);
+            _overflow.push(*this, pHandles[0], pHandles[size - 1], size);
+        }
+
+        T &get(handle id) { return slot(id).value; }
+
+        /// @brief Number of resources owned by the pool
+        size_t capacity() const { return _capacity.load(std::memory_order_acquire); }
+
+        /// @brief Approximate number of free resources
+        size_t size() const
+        {
+            size_t free = _overflow.count.load(std::memory_order_relaxed);
+            for (auto &shard : _shards) free += shard.count.load(std::memory_order_relaxed);
+            return free;
+        }
+
+    private:
+        struct slot_data
+        {
+            T value;
+            std::atomic<handle> next{invalid_handle};
+        };
+
+        struct chunk
+        {
+            slot_data slots[chunk_size];
+        };
+
+        struct free_list
+        {
+            // Low 32 bits: index of the top slot, high 32 bits: modification tag
+            std::atomic<u64> head{invalid_handle};
+            std::atomic<size_t> count{0};
+
+            void push(concurrent_resource_pool &pool, handle first, handle last, size_t size)
+            {
+                u64 old_head = head.load(std::memory_order_relaxed);
+                u64 new_head;
+                do
+                {
+                    pool.slot(last).next.store(static_cast<handle>(old_head), std::memory_order_relaxed);
+                    new_head = ((old_head >> 32) + 1) << 32 | first;
+                } while (!head.compare_exchange_weak(old_head, new_head, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+                count.fetch_add(size, std::memory_order_relaxed);
+            }
+
+            handle pop(concurrent_resource_pool &pool)
+            {
+                handle id;
+                return pop(pool, &id, 1) ? id : invalid_handle;
+            }
+
+            /// Detach up to `size` slots from the top with a single CAS. The walked links may be stale if another
+            /// thread changes the list meanwhile, but then the tag has changed as well and the CAS fails.
+            size_t pop(concurrent_resource_pool &pool, handle *pHandles, size_t size)
+            {
+                u64 old_head = head.load(std::memory_order_acquire);
+                size_t taken;
+                u64 new_head;
+                do
+                {
+                    taken = 0;
+                    handle top = static_cast<handle>(old_head);
+                    while (taken < size && top != invalid_handle)
+                    {
+                        pHandles[taken++] = top;
+                        top = pool.slot(top).next.load(std::memory_order_relaxed);
+                    }
+                    if (taken == 0) return 0;
+                    new_head = ((old_head >> 32) + 1) << 32 | top;
+                } while (!head.compare_exchange_weak(old_head, new_head, std::memory_order_acquire,
+                                                     std::memory_order_acquire));
+                count.fetch_sub(taken, std::memory_order_relaxed);
+                return taken;
+            }
+        };
+
+        std::atomic<chunk *> _chunks[max_chunks] = {};
+        std::atomic<size_t> _capacity{0};
+        free_list _shards[shard_count];
+        free_list _overflow;
+        std::mutex _grow_lock;
+
+        slot_data &slot(handle id)
+        {
+            return _chunks[id / chunk_size].load(std::memory_order_acquire)->slots[id % chunk_size];
+        }
+
+        static size_t shard_index()
+        {
+            static thread_local size_t index = std::hash<std::thread::id>{}(std::this_thread::get_id()) % shard_count;
+            return index;
+        }
+
+        size_t steal(handle *pHandles, size_t size)
+        {
+            for (auto &shard : _shards)
+                if (size_t count = shard.pop(*this, pHandles, size)) return count;
+            return 0;
+        }
+
+        /// Allocate `size` new resources and hand them out directly if a destination is given
+        void grow(size_t size, T *pData, handle *pHandles)
+        {
+            std::lock_guard<std::mutex> lock(_grow_lock);
+            size_t first = _capacity.load(std::memory_order_relaxed);
+            size_t last = first + size;
+            if (last > max_chunks * chunk_size) throw acul::bad_alloc(size);
+            for (size_t c = (first + chunk_size - 1) / chunk_size; c * chunk_size < last; ++c)
+                _chunks[c].store(acul::alloc<chunk>(), std::memory_order_release);
+
+            acul::vector<T> values(size);
+            allocator.alloc(values.data(), size);
+            for (size_t i = 0; i < size; ++i) slot(static_cast<handle>(first + i)).value = values[i];
+            _capacity.store(last, std::memory_order_release);
+
+            if (pData)
+            {
+                std::copy_n(values.data(), size, pData);
+                if (pHandles)
+                    for (size_t i = 0; i < size; ++i) pHandles[i] = static_cast<handle>(first + i);
+                return;
+            }
+            for (size_t i = first; i + 1 < last; ++i)
+                slot(static_cast<handle>(i)).next.store(static_cast<handle>(i + 1), std::memory_order_relaxed);
+            _overflow.push(*this, static_cast<handle>(first), static_cast<handle>(last - 1), size);
+        }
+
+        void release_storage()
+        {
+            for (auto &c : _chunks)
+            {
+                chunk *data = c.exchange(nullptr);
+                if (data) acul::release(data);
+            }
+            _capacity = 0;
+            for (auto &shard : _shards)
+            {
+                shard.head = invalid_handle;
+                shard.count = 0;
+            }
+            _overflow.head = invalid_handle;
+            _overflow.count = 0;
+        }
+    };
+} // namespace agrb
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <acul/functional/unique_function.hpp>
+#include <acul/hash/hashmap.hpp>
+#include "framebuffer.hpp"
+#include "texture.hpp"
+#include "utils/buffer.hpp"
+
+namespace agrb
+{
+    struct defrag_config
+    {
+        /// Upper bound of bytes copied by one pass, keeps a pass cheap enough to run inside a frame
+        vk::DeviceSize bytes_per_pass = 8u << 20;
+        u32 allocations_per_pass = 64;
+        VmaDefragmentationFlags flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+
+        defrag_config &set_bytes_per_pass(vk::DeviceSize value)
+        {
+            bytes_per_pass = value;
+            return *this;
+        }
+
+        defrag_config &set_allocations_per_pass(u32 value)
+        {
+            allocations_per_pass = value;
+            return *this;
+        }
+
+        defrag_config &set_flags(VmaDefragmentationFlags value)
+        {
+            flags = value;
+            return *this;
+        }
+    };
+
+    struct defrag_stats
+    {
+        u64 passes = 0;
+        u64 moved_allocations = 0;
+        vk::DeviceSize moved_bytes = 0;
+        vk::DeviceSize freed_bytes = 0;
+    };
+
+    /**
+     * @brief Compacts device memory with VMA defragmentation, moving resources with GPU copies.
+     *
+     * Only tracked resources are moved. A pass is recorded into an execution context, typically at the start of
+     * the frame command buffer: record_pass() creates the resources at their new place, records the copies and
+     * immediately switches the owners to the new handles, so every command recorded after it already uses them.
+     * The on_moved callback of a resource is the place to rewrite descriptor sets and recreate views.
+     * Once the GPU has executed the submission, end_pass() destroys the old resources. With a frame_controller
+     * this is when the frame slot that recorded the pass begins again.
+     *
+     * Host mapped buffers are never moved. Resources must be untracked before they are destroyed.
+     */
+    class defragmenter
+    {
+    public:
+        explicit defragmenter(device &device) : _device(device) {}
+
+        defragmenter(const defragmenter &) = delete;
+        defragmenter &operator=(const defragmenter &) = delete;
+
+        ~defragmenter() { cancel(); }
+
+        /// @brief Track a buffer created with the given usage. vk_buffer and address are replaced when it moves
+        AGRB_EXPORT void track(buffer &buffer, vk::BufferUsageFlags usage,
+                               acul::unique_function<void(agrb::buffer &)> &&on_moved = {});
+
+        /// @brief Track a texture in eShaderReadOnlyOptimal layout. The image and its view are replaced
+        AGRB_EXPORT void track(texture &texture, vk::ImageUsageFlags usage, vk::ImageViewType view_type,
+                               acul::unique_function<void(agrb::texture &)> &&on_moved = {});
+
+        /**
+         * @brief Track a framebuffer image. Its views belong to the owner: on_moved receives the old image and
+         * must create views of the new one; the old views must be kept until end_pass()
+         * @param image_info Create info of the image, the usage must include eTransferSrc and eTransferDst
+         * @param layout Layout of the image between frames
+         */
+        AGRB_EXPORT void track(fb_image &image, const vk::ImageCreateInfo &image_info, vk::ImageLayout layout,
+                               acul::unique_function<void(fb_image &, vk::Image)> &&on_moved);
+
+        /// @brief Stop tracking a resource. Must be called before the resource is destroyed
+        void untrack(VmaAllocation allocation) { _tracked.erase(allocation); }
+
+        /// @brief Start a defragmentation run. Does nothing if one is already running
+        AGRB_EXPORT bool begin(const defrag_config &config = {});
+
+        /**
+         * @brief Record the copies of the next pass
+         * @return False if no pass was recorded because the run has finished or was never begun
+         */
+        AGRB_EXPORT bool record_pass(single_time_exec &exec);
+
+        /// @brief Finish the recorded pass. The submission of record_pass() must have completed
+        AGRB_EXPORT void end_pass();
+
+        /// @brief Record, submit and finish passes until the run is done, e.g. behind a loading screen
+        AGRB_EXPORT void run();
+
+        /// @brief Abort the run. A recorded pass is finished first, so it must have completed
+        AGRB_EXPORT void cancel();
+
+        bool running() const { return _context != VK_NULL_HANDLE; }
+
+        bool pass_pending() const { return !_moves.empty() || _pass_open; }
+
+        const defrag_stats &stats() const { return _stats; }
+
+    private:
+        enum class resource_kind
+        {
+            buffer,
+            texture,
+            fb_image
+        };
+
+        struct tracked_resource
+        {
+            resource_kind kind;
+            void *owner;
+            vk::BufferCreateInfo buffer_info;
+            vk::ImageCreateInfo image_info;
+            vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+            vk::ImageViewType view_type = vk::ImageViewType::e2D;
+            acul::unique_function<void(buffer &)> on_buffer_moved;
+            acul::unique_function<void(texture &)> on_texture_moved;
+            acul::unique_function<void(fb_image &, vk::Image)> on_fb_image_moved;
+        };
+
+        struct pending_move
+        {
+            vk::Buffer old_buffer;
+            vk::Image old_image;
+            vk::ImageView old_view;
+        };
+
+        device &_device;
+        acul::hashmap<VmaAllocation, tracked_resource> _tracked;
+        VmaDefragmentationContext _context = VK_NULL_HANDLE;
+        VmaDefragmentationPassMoveInfo _pass{};
+        bool _pass_open = false;
+        acul::vector<pending_move> _moves;
+        defrag_stats _stats;
+
+        bool move(VmaDefragmentationMove &move, single_time_exec &exec);
+        void finish();
+    };
+} // namespace agrb
@@ -1,6 +1,7 @@
 #pragma once
 #include <acul/hash/hashset.hpp>
 #include <acul/set.hpp>
+#include <atomic>
 #if defined(__clang__)
     #pragma clang diagnostic push
     #pragma clang diagnostic ignored "-Wnullability-completeness"
@@ -97,15 +98,14 @@ namespace agrb
 
         void alloc(vk::CommandBuffer *pBuffers, size_t size)
         {
+            if (size == 0) return;
             vk::CommandBufferAllocateInfo allocInfo(*command_pool, Level, size);
             auto res = device->allocateCommandBuffers(&allocInfo, pBuffers, *loader);
             if (res != vk::Result::eSuccess) throw acul::bad_alloc(size);
         }
 
-        void release(vk::CommandBuffer &buffer)
-        {
-            // No need 'cos all buffers will be destroying after call VkDestroyCommandPool
-        }
+        // Destroying the command pool frees all of its buffers, this is only used when a pool shrinks.
+        void release(vk::CommandBuffer &buffer) { device->freeCommandBuffers(*command_pool, 1, &buffer, *loader); }
     };
 
     using primary_command_buffer_pool =
@@ -118,6 +118,79 @@ namespace agrb
         vk::CommandPool vk_pool;
         primary_command_buffer_pool primary;
         secondary_command_buffer_pool secondary;
+
+        /// @brief Free idle command buffers beyond the policy and return unused pool memory to the driver
+        /// @return Number of freed command buffers
+        size_t trim(vk::Device device, vk::DispatchLoaderDynamic &loader, const pool_shrink_policy &policy)
+        {
+            if (!vk_pool) return 0;
+            size_t released = primary.shrink(policy) + secondary.shrink(policy);
+            device.trimCommandPool(vk_pool, {}, loader);
+            return released;
+        }
+    };
+
+    /**
+     * @brief Timeline semaphore that counts the submissions of a queue.
+     *
+     * Every submission signals the next value, so "the GPU has finished submission N" becomes
+     * "the semaphore reached N". Values are handed out in submission order; callers that submit to the same queue
+     * from several threads must serialize next() together with the submit call.
+     */
+    struct queue_timeline
+    {
+        vk::Semaphore semaphore;
+        std::atomic<u64> last_value{0};
+
+        bool valid() const { return static_cast<bool>(semaphore); }
+
+        /// @brief Reserve the value signaled by the next submission
+        u64 next() { return ++last_value; }
+
+        /// @brief Last value the GPU has signaled
+        u64 completed(vk::Device device, vk::DispatchLoaderDynamic &loader) const
+        {
+            return device.getSemaphoreCounterValue(semaphore, loader);
+        }
+
+        bool reached(u64 value, vk::Device device, vk::DispatchLoaderDynamic &loader) const
+        {
+            return completed(device, loader) >= value;
+        }
+
+        /// @brief Block until the semaphore reaches the value or the timeout expires
+        vk::Result wait(u64 value, vk::Device device, vk::DispatchLoaderDynamic &loader,
+                        u64 timeout = UINT64_MAX) const
+        {
+            vk::SemaphoreWaitInfo wait_info;
+            wait_info.setSemaphoreCount(1).setPSemaphores(&semaphore).setPValues(&value);
+            return device.waitSemaphores(wait_info, timeout, loader);
+        }
+
+        void create(vk::Device device, vk::DispatchLoaderDynamic &loader)
+        {
+            vk::SemaphoreTypeCreateInfo type_info(vk::SemaphoreType::eTimeline, 0);
+            vk::SemaphoreCreateInfo create_info;
+            create_info.setPNext(&type_info);
+            semaphore = device.createSemaphore(create_info, nullptr, loader);
+            last_value = 0;
+        }
+
+        void destroy(vk::Device device, vk::DispatchLoaderDynamic &loader)
+        {
+            if (!semaphore) return;
+            device.destroySemaphore(semaphore, nullptr, loader);
+            semaphore = nullptr;
+        }
+    };
+
+    /// @brief Point on a queue timeline: "queue X reached value N"
+    struct timeline_point
+    {
+        queue_timeline *timeline = nullptr;
+        u64 value = 0;
+
+        bool valid() const { return timeline && timeline->valid(); }
     };
 
     struct queue_family_info
@@ -125,6 +198,7 @@ namespace agrb
         std::optional<u32> family_id;
         vk::Queue vk_queue;
         command_pool pool;
+        queue_timeline timeline;
     };
 
     struct device_queue_group
@@ -132,14 +206,61 @@ namespace agrb
         queue_family_info graphics;
         queue_family_info compute;
         queue_family_info present;
+        queue_family_info transfer;
+
+        /// @brief Check whether staging copies can run on a transfer-only queue family
+        bool has_dedicated_transfer() const
+        {
+            return transfer.family_id.has_value() && transfer.vk_queue && transfer.pool.vk_pool &&
+                   transfer.family_id != graphics.family_id;
+        }
+
+        /// @brief Check whether compute work can run on a family without graphics, asynchronously to rendering
+        bool has_dedicated_compute() const
+        {
+            return compute.family_id.has_value() && compute.vk_queue && compute.pool.vk_pool &&
+                   compute.family_id != graphics.family_id;
+        }
+
+        /// @brief Create the timeline semaphores of all queues that own a command pool
+        void create_timelines(vk::Device device, vk::DispatchLoaderDynamic &loader)
+        {
+            for (auto *queue : {&graphics, &compute, &transfer})
+                if (queue->vk_queue && !queue->timeline.valid()) queue->timeline.create(device, loader);
+        }
+
+        /// @brief Block until every submission tracked by the queue timelines has completed
+        void wait_timelines(vk::Device device, vk::DispatchLoaderDynamic &loader)
+        {
+            for (auto *queue : {&graphics, &compute, &transfer})
+                if (queue->timeline.valid()) queue->timeline.wait(queue->timeline.last_value, device, loader);
+        }
+
+        /// @brief Trim the command pools of all queues
+        /// @return Number of freed command buffers
+        size_t trim(vk::Device device, vk::DispatchLoaderDynamic &loader, const pool_shrink_policy &policy)
+        {
+            size_t released = 0;
+            for (auto *queue : {&graphics, &compute, &transfer}) released += queue->pool.trim(device, loader, policy);
+            return released;
+        }
 
         void destroy(vk::Device device, vk::DispatchLoaderDynamic &loader)
         {
             device.destroyCommandPool(graphics.pool.vk_pool, nullptr, loader);
             device.destroyCommandPool(compute.pool.vk_pool, nullptr, loader);
+            if (transfer.pool.vk_pool) device.destroyCommandPool(transfer.pool.vk_pool, nullptr, loader);
+            for (auto *queue : {&graphics, &compute, &transfer}) queue->timeline.destroy(device, loader);
         }
     };
 
+    /// @brief Queue family ownership transfer of a resource between two queues
+    struct queue_ownership
+    {
+        u32 src_family; ///< Family releasing the resource
+        u32 dst_family; ///< Family acquiring the resource
+    };
+
     struct fence_pool_alloc
     {
         vk::Device *device = nullptr;
@@ -155,12 +276,36 @@ namespace agrb
         void release(vk::Fence &fence) { device->destroyFence(fence, nullptr, *loader); }
     };
 
+    using fence_resource_pool = resource_pool<vk::Fence, fence_pool_alloc>;
+
+    /// @brief Optional device features used by agrb when the device has them enabled
+    struct enabled_device_features
+    {
+        bool timeline_semaphores = false;
+        bool synchronization2 = false;
+        /// VK_EXT_memory_budget, lets VMA report the real heap budgets
+        bool memory_budget = false;
+        /// Buffers created with eShaderDeviceAddress expose their GPU address, see buffer::device_address()
+        bool buffer_device_address = false;
+        /// Tessellation and geometry stages may appear in stage masks only when their features are enabled
+        bool tessellation_shader = false;
+        bool geometry_shader = false;
+    };
+
+    class staging_ring;
+    struct memory_budget_policy;
+
     struct device_runtime_data
     {
         device_queue_group queues;
+        enabled_device_features features;
         vk::PhysicalDeviceProperties2 properties2;
         vk::PhysicalDeviceMemoryProperties memory_properties;
-        resource_pool<vk::Fence, fence_pool_alloc> fence_pool;
+        fence_resource_pool fence_pool;
+        /// Optional staging ring owned by the application. Staging uploads sub-allocate from it when it is set.
+        staging_ring *staging = nullptr;
+        /// Optional allocation policy owned by the application, see memory_budget_policy
+        memory_budget_policy *budget_policy = nullptr;
 
         void destroy(vk::Device &device, vk::DispatchLoaderDynamic &loader)
         {
@@ -168,6 +313,39 @@ namespace agrb
             fence_pool.destroy();
         }
 
+        /**
+         * @brief Release idle command buffers and fences after a burst of work, e.g. once loading has finished.
+         * Must not run concurrently with users of the pools.
+         * @return Number of released objects
+         */
+        size_t trim_pools(vk::Device device, vk::DispatchLoaderDynamic &loader, const pool_shrink_policy &policy)
+        {
+            return queues.trim(device, loader, policy) + fence_pool.shrink(policy);
+        }
+
+        /**
+         * @brief Memory types that are device local and host visible on a heap large enough for regular resources:
+         * all memory of integrated and CPU devices, or the whole VRAM behind a resizable BAR. The classic 256 MiB
+         * BAR window is not included. Zero if uploads to device local memory need a staging copy.
+         */
+        u32 direct_write_memory_types() const
+        {
+            constexpr vk::DeviceSize bar_window_size = 256ull << 20;
+            auto device_type = properties2.properties.deviceType;
+            bool uma =
+                device_type == vk::PhysicalDeviceType::eIntegratedGpu || device_type == vk::PhysicalDeviceType::eCpu;
+            const vk::MemoryPropertyFlags direct_flags =
+                vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+            u32 types = 0;
+            for (u32 i = 0; i < memory_properties.memoryTypeCount; ++i)
+            {
+                auto &type = memory_properties.memoryTypes[i];
+                if ((type.propertyFlags & direct_flags) != direct_flags) continue;
+                if (uma || memory_properties.memoryHeaps[type.heapIndex].size > bar_window_size) types |= 1u << i;
+            }
+            return types;
+        }
+
         /// @brief Get aligned size for UBO buffer by current physical device
         /// @param original_size Size of original buffer
         size_t get_aligned_ubo_size(size_t original_size) const
@@ -244,6 +422,8 @@ namespace agrb
         acul::vector<optional_device_feature> device_features_optional;
         size_t fence_pool_size;
         vk::PhysicalDeviceFeatures device_features;
+        /// Enable the bufferDeviceAddress feature when the device supports it
+        bool buffer_device_address;
         void *device_logical_next = nullptr;
         void *device_physical_next = nullptr;
         device_runtime_data *runtime_data = nullptr;
@@ -297,6 +477,12 @@ namespace agrb
             return *this;
         }
 
+        device_create_ctx &set_buffer_device_address(bool enable)
+        {
+            buffer_device_address = enable;
+            return *this;
+        }
+
         device_create_ctx &set_present_ctx(device_present_ctx *ctx)
         {
             present_ctx = ctx;
@@ -347,6 +533,7 @@ namespace agrb
 
     inline device_create_ctx::device_create_ctx()
         : fence_pool_size(0),
+          buffer_device_address(false),
           device_logical_next(nullptr),
           device_physical_next(nullptr),
           runtime_data(nullptr),
@@ -20,6 +20,10 @@ namespace agrb
         u32 present_family_id = 0;
         bool has_present_queue = false;
 
+        vk::Queue transfer_queue{};
+        u32 transfer_family_id = 0;
+        bool has_transfer_queue = false;
+
         // Runtime
         device_runtime_data *runtime_data = nullptr; // Optional external runtime storage.
 
@@ -29,6 +33,7 @@ namespace agrb
         size_t graphics_secondary_buffers = 10;
         size_t compute_primary_buffers = 2;
         size_t compute_secondary_buffers = 2;
+        size_t transfer_primary_buffers = 2;
 
         // Fence pool
         bool create_fence_pool = false;
@@ -37,6 +42,10 @@ namespace agrb
         // Optional existing allocator.
         VmaAllocator allocator = nullptr;
 
+        // Features the application enabled on the device. Timeline semaphores are created for every queue
+        // when they are enabled.
+        enabled_device_features features;
+
         adopted_device_create_info &set_instance(vk::Instance value)
         {
             instance = value;
@@ -77,6 +86,14 @@ namespace agrb
             return *this;
         }
 
+        adopted_device_create_info &set_transfer_queue(vk::Queue queue, u32 family_id)
+        {
+            transfer_queue = queue;
+            transfer_family_id = family_id;
+            has_transfer_queue = static_cast<bool>(queue);
+            return *this;
+        }
+
         adopted_device_create_info &set_runtime_data(device_runtime_data *value)
         {
             runtime_data = value;
@@ -103,6 +120,12 @@ namespace agrb
             return *this;
         }
 
+        adopted_device_create_info &set_transfer_command_buffers(size_t primary)
+        {
+            transfer_primary_buffers = primary;
+            return *this;
+        }
+
         adopted_device_create_info &set_create_fence_pool(bool value)
         {
             create_fence_pool = value;
@@ -120,6 +143,12 @@ namespace agrb
             allocator = value;
             return *this;
         }
+
+        adopted_device_create_info &set_enabled_features(const enabled_device_features &value)
+        {
+            features = value;
+            return *this;
+        }
     };
 
     AGRB_EXPORT void initialize_adopted_device(device &device, const adopted_device_create_info &create_info);
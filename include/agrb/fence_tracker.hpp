@@ -0,0 +1,107 @@
+#pragma once
+
+#include <acul/functional/unique_function.hpp>
+#include "device.hpp"
+
+namespace agrb
+{
+    /// @brief How a fence_tracker waits: poll the fences for a short while, then block in the driver
+    struct fence_wait_policy
+    {
+        /// Time in nanoseconds spent polling vkGetFenceStatus before blocking in vkWaitForFences
+        u64 spin_ns = 20000;
+
+        fence_wait_policy &set_spin_ns(u64 ns)
+        {
+            spin_ns = ns;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Tracks in-flight pooled fences and reclaims them once they are signaled.
+     *
+     * acquire() hands out a reset fence from the device fence pool; the caller submits with it. collect() queries
+     * every tracked fence once and returns the signaled ones to the pool, invoking their completion callbacks, so
+     * fences no longer need an explicit wait to be reclaimed. wait_any() and wait_all() block on a subset of
+     * the tracked submissions using a spin-then-sleep policy.
+     *
+     * The tracker is not thread-safe; it is meant to be owned by the thread that submits the work.
+     */
+    class fence_tracker
+    {
+    public:
+        using id = u64;
+
+        explicit fence_tracker(device &device) : _device(device) {}
+
+        fence_tracker(const fence_tracker &) = delete;
+        fence_tracker &operator=(const fence_tracker &) = delete;
+
+        ~fence_tracker() { flush(); }
+
+        /**
+         * @brief Take an unsignaled fence from the pool and start tracking it
+         * @param on_complete Optional callback invoked with the fence status once the fence is collected
+         * @param out Receives the tracking id of the fence
+         * @return Fence to pass to the queue submission. It must be submitted, otherwise flush() never returns
+         */
+        AGRB_EXPORT vk::Fence acquire(id &out, acul::unique_function<void(vk::Result)> &&on_complete = {});
+
+        /// @brief Check whether a tracked fence has already been collected
+        bool completed(id fence_id) const { return find(fence_id) == _in_flight.size(); }
+
+        /// @brief Query every tracked fence once and reclaim the signaled ones
+        /// @return Number of reclaimed fences
+        AGRB_EXPORT size_t collect();
+
+        /**
+         * @brief Block until any of the fences is signaled
+         * @param ids Tracking ids returned by acquire(). Ids that were already collected count as signaled
+         * @param timeout Timeout in nanoseconds
+         * @return vk::Result::eSuccess once a fence is signaled, vk::Result::eTimeout otherwise
+         */
+        vk::Result wait_any(const id *ids, size_t count, u64 timeout = UINT64_MAX, const fence_wait_policy &policy = {})
+        {
+            return wait(ids, count, false, timeout, policy);
+        }
+
+        /// @brief Block until all of the fences are signaled. See wait_any()
+        vk::Result wait_all(const id *ids, size_t count, u64 timeout = UINT64_MAX, const fence_wait_policy &policy = {})
+        {
+            return wait(ids, count, true, timeout, policy);
+        }
+
+        /// @brief Wait for every tracked fence and reclaim it
+        AGRB_EXPORT void flush();
+
+        /// @brief Number of fences in flight
+        size_t size() const { return _in_flight.size(); }
+
+    private:
+        struct tracked_fence
+        {
+            id fence_id;
+            vk::Fence fence;
+            fence_resource_pool::handle handle;
+            acul::unique_function<void(vk::Result)> on_complete;
+        };
+
+        device &_device;
+        acul::vector<tracked_fence> _in_flight;
+        id _next_id = 0;
+
+        size_t find(id fence_id) const
+        {
+            for (size_t i = 0; i < _in_flight.size(); ++i)
+                if (_in_flight[i].fence_id == fence_id) return i;
+            return _in_flight.size();
+        }
+
+        AGRB_EXPORT vk::Result wait(const id *ids, size_t count, bool all, u64 timeout,
+                                    const fence_wait_policy &policy);
+
+        // Reclaim the fences whose status is not eNotReady. Statuses are indexed like _in_flight
+        size_t reclaim(const acul::vector<vk::Result> &statuses);
+    };
+} // namespace agrb
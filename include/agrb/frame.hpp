@@ -0,0 +1,130 @@
+#pragma once
+
+#include <acul/functional/unique_function.hpp>
+#include "device.hpp"
+
+namespace agrb
+{
+    /// @brief Resources owned by one frame in flight
+    struct frame_slot
+    {
+        vk::CommandPool command_pool;
+        vk::CommandBuffer command_buffer;
+        vk::Semaphore image_available; ///< Signaled by the presentation engine when the acquired image is ready
+        vk::Fence in_flight;           ///< Signaled when the GPU has finished the frame's submission
+        timeline_point submitted;      ///< Graphics timeline value of the frame's submission, if supported
+    };
+
+    /**
+     * @brief Drives the acquire/record/submit/present loop with a fixed number of frames in flight.
+     *
+     * Every frame in flight owns its command buffer, acquire semaphore and fence, so the CPU records frame N + 1
+     * while the GPU still executes frame N. begin_frame() only blocks when the CPU gets more than
+     * frames_in_flight() frames ahead. Render-finished semaphores are owned per swapchain image, because the
+     * presentation engine may still hold the one of an image while another frame slot is already reused.
+     *
+     * The frame index is stable for the lifetime of the controller and can be used to key per-frame resources
+     * such as command_pool_registry pools or framebuffer::get_fb(). Callbacks registered with on_frame_begin()
+     * run once the frame's previous submission is known to have completed.
+     */
+    class frame_controller
+    {
+    public:
+        frame_controller() = default;
+
+        frame_controller(const frame_controller &) = delete;
+        frame_controller &operator=(const frame_controller &) = delete;
+
+        ~frame_controller() { assert(_frames.empty() && "destroy() must be called before the device is gone"); }
+
+        /**
+         * @brief Create the per-frame resources
+         * @param device Device
+         * @param frames_in_flight Number of frames the CPU may record ahead of the GPU
+         */
+        AGRB_EXPORT void create(device &device, u32 frames_in_flight = 2);
+
+        /// @brief Wait for all frames in flight and destroy the per-frame resources
+        AGRB_EXPORT void destroy();
+
+        /**
+         * @brief Start a new frame: wait for the frame slot, acquire a swapchain image and begin the command buffer
+         * @param swapchain Swapchain to acquire from
+         * @param timeout Timeout of the fence wait and of the acquire in nanoseconds
+         * @return vk::Result::eErrorOutOfDateKHR if the swapchain has to be recreated. No frame is started then
+         */
+        vk::Result begin_frame(vk::SwapchainKHR swapchain, u64 timeout = UINT64_MAX)
+        {
+            assert(swapchain);
+            return begin(swapchain, timeout);
+        }
+
+        /// @brief Start a frame that renders off-screen: same as begin_frame() without acquiring an image
+        vk::Result begin_offscreen_frame(u64 timeout = UINT64_MAX) { return begin(nullptr, timeout); }
+
+        /**
+         * @brief End the command buffer, submit it to the graphics queue and present the acquired image
+         * @param swapchain Swapchain the image was acquired from
+         * @return Result of the presentation, e.g. vk::Result::eSuboptimalKHR
+         */
+        AGRB_EXPORT vk::Result end_frame(vk::SwapchainKHR swapchain);
+
+        /// @brief End a frame started with begin_offscreen_frame() and submit it without presenting
+        AGRB_EXPORT vk::Result end_offscreen_frame();
+
+        /**
+         * @brief Make the next end_frame() submission wait for a point on another queue, e.g. async compute work
+         * @param point Timeline point to wait for
+         * @param stage Pipeline stages that must not start before the point is reached
+         */
+        void wait_for(const timeline_point &point, vk::PipelineStageFlags stage)
+        {
+            assert(point.valid());
+            _waits.push_back({point.timeline->semaphore, point.value, stage});
+        }
+
+        /// @brief Register a callback invoked when a frame begins with its frame index, e.g. to reset per-frame pools
+        void on_frame_begin(acul::unique_function<void(u32)> &&callback)
+        {
+            _frame_begin_callbacks.push_back(std::move(callback));
+        }
+
+        /// @brief Index of the current frame slot in [0, frames_in_flight())
+        u32 frame_index() const { return _frame_index; }
+
+        /// @brief Index of the acquired swapchain image
+        u32 image_index() const { return _image_index; }
+
+        /// @brief Number of frames begun since creation
+        u64 frame_number() const { return _frame_number; }
+
+        u32 frames_in_flight() const { return static_cast<u32>(_frames.size()); }
+
+        frame_slot &current() { return _frames[_frame_index]; }
+
+        vk::CommandBuffer command_buffer() const { return _frames[_frame_index].command_buffer; }
+
+    private:
+        struct frame_wait
+        {
+            vk::Semaphore semaphore;
+            u64 value;
+            vk::PipelineStageFlags stage;
+        };
+
+        device *_device = nullptr;
+        acul::vector<frame_slot> _frames;
+        acul::vector<frame_wait> _waits;
+        acul::vector<vk::Semaphore> _render_finished;
+        acul::vector<acul::unique_function<void(u32)>> _frame_begin_callbacks;
+        u32 _frame_index = 0;
+        u32 _image_index = 0;
+        u64 _frame_number = 0;
+        bool _recording = false;
+
+        AGRB_EXPORT vk::Result begin(vk::SwapchainKHR swapchain, u64 timeout);
+
+        /// Submit the current frame. On failure the slot is recovered so that it can be begun again
+        vk::Result submit(bool acquired, vk::Semaphore render_finished);
+    };
+} // namespace agrb
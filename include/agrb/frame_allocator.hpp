@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include "utils/buffer.hpp"
+
+namespace agrb
+{
+    struct frame_allocator_stats
+    {
+        vk::DeviceSize frame_capacity = 0;
+        /// Bytes used by the current frame, including alignment padding
+        vk::DeviceSize used = 0;
+        vk::DeviceSize peak_used = 0;
+        /// Allocations that did not fit into the frame region
+        u64 overflows = 0;
+    };
+
+    /**
+     * @brief Linear allocator for data that lives for one frame: per-draw uniforms, storage data and
+     * immediate-mode vertices and indices.
+     *
+     * One persistently mapped buffer is split into a region per frame in flight. reset() selects the region of the
+     * frame being recorded and rewinds it, allocations are a single atomic bump, so they may be made from several
+     * recording threads. The region is reused once the frame controller has waited for the frame that last used
+     * it, which makes resetting it safe without any tracking. Hook it up with
+     * frame_controller::on_frame_begin([&](u32 frame) { allocator.reset(frame); }).
+     */
+    class frame_allocator
+    {
+    public:
+        frame_allocator() = default;
+
+        frame_allocator(const frame_allocator &) = delete;
+        frame_allocator &operator=(const frame_allocator &) = delete;
+
+        ~frame_allocator() { destroy(); }
+
+        /**
+         * @brief Create the backing buffer
+         * @param frame_capacity Bytes available to each frame
+         * @param frames Number of frames in flight
+         * @param usage Buffer usage. Offsets of uniform and storage allocations follow the matching device limits
+         * @return True on success
+         */
+        AGRB_EXPORT bool create(device &device, vk::DeviceSize frame_capacity, u32 frames,
+                                vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eUniformBuffer |
+                                                             vk::BufferUsageFlagBits::eStorageBuffer |
+                                                             vk::BufferUsageFlagBits::eVertexBuffer |
+                                                             vk::BufferUsageFlagBits::eIndexBuffer);
+
+        AGRB_EXPORT void destroy();
+
+        bool valid() const { return _buffer.vk_buffer; }
+
+        /// @brief Rewind the region of a frame and make it current. Must not race with allocate()
+        void reset(u32 frame)
+        {
+            assert(frame < _frames);
+            _base = frame * _frame_capacity;
+            _head.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Bump-allocate a range of the current frame
+         * @param size Size in bytes
+         * @param alignment Power of two alignment of the offset inside the backing buffer
+         * @param out Range sharing the backing buffer. offset is the absolute offset to bind or to pass as a
+         * dynamic offset and mapped points to the first byte of the range
+         * @return False if the frame region is exhausted
+         */
+        AGRB_EXPORT bool allocate(vk::DeviceSize size, vk::DeviceSize alignment, buffer &out);
+
+        /// @brief Allocate a range for a (dynamic) uniform buffer descriptor
+        bool allocate_uniform(vk::DeviceSize size, buffer &out) { return allocate(size, _uniform_alignment, out); }
+
+        /// @brief Allocate a range for a storage buffer descriptor
+        bool allocate_storage(vk::DeviceSize size, buffer &out) { return allocate(size, _storage_alignment, out); }
+
+        /// @brief Allocate a range for vertex or index data
+        bool allocate_vertices(vk::DeviceSize size, buffer &out) { return allocate(size, 16, out); }
+
+        /// @brief Allocate a range and copy data into it
+        bool push(const void *data, vk::DeviceSize size, vk::DeviceSize alignment, buffer &out)
+        {
+            if (!allocate(size, alignment, out)) return false;
+            memcpy(out.mapped, data, size);
+            return true;
+        }
+
+        /// @brief Make the writes of the current frame visible to the device. No-op on host coherent memory
+        AGRB_EXPORT vk::Result flush();
+
+        /// @brief Backing buffer, e.g. to write a dynamic uniform buffer descriptor once per frame region
+        const buffer &data() const { return _buffer; }
+
+        AGRB_EXPORT frame_allocator_stats stats() const;
+
+    private:
+        device *_device = nullptr;
+        buffer _buffer;
+        vk::DeviceSize _frame_capacity = 0;
+        u32 _frames = 0;
+        vk::DeviceSize _base = 0;
+        std::atomic<vk::DeviceSize> _head{0};
+        vk::DeviceSize _uniform_alignment = 16;
+        vk::DeviceSize _storage_alignment = 16;
+        bool _coherent = true;
+        std::atomic<vk::DeviceSize> _peak{0};
+        std::atomic<u64> _overflows{0};
+    };
+} // namespace agrb
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <acul/functional/unique_function.hpp>
+#include "device.hpp"
+
+namespace agrb
+{
+    /// @brief Usage snapshot of a memory heap
+    struct heap_budget
+    {
+        /// Bytes used by the process, including memory not allocated through VMA
+        vk::DeviceSize usage = 0;
+        /// Bytes the process can use before the driver starts paging. Estimated without VK_EXT_memory_budget
+        vk::DeviceSize budget = 0;
+        /// Bytes of device memory blocks allocated by VMA
+        vk::DeviceSize block_bytes = 0;
+        /// Bytes of VMA allocations placed in those blocks
+        vk::DeviceSize allocation_bytes = 0;
+        vk::MemoryHeapFlags flags;
+
+        f32 load() const { return budget ? static_cast<f32>(usage) / static_cast<f32>(budget) : 0.0f; }
+    };
+
+    /// @brief Query the usage and budget of every memory heap. Values are refreshed by VMA once per frame index
+    AGRB_EXPORT void get_heap_budgets(const device &device, acul::vector<heap_budget> &budgets);
+
+    /**
+     * @brief Allocation policy applied to create_buffer() and the device create_image() overload while it is set
+     * as device_runtime_data::budget_policy.
+     *
+     * An allocation that would bring its heap above threshold * budget first calls on_pressure, which may release
+     * memory, e.g. by collecting a retire_queue or shrinking caches. The allocation then runs with
+     * VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT, so VMA places it in another compatible memory type instead of
+     * overcommitting the heap. Only if no memory type has room it falls back to an unrestricted allocation,
+     * unless allow_over_budget is cleared.
+     */
+    struct memory_budget_policy
+    {
+        using pressure_callback = acul::unique_function<void(u32, const heap_budget &, vk::DeviceSize)>;
+
+        f32 threshold = 0.9f;
+        bool allow_over_budget = true;
+        /// Receives the heap index, its current snapshot and the requested size
+        pressure_callback on_pressure;
+
+        memory_budget_policy &set_threshold(f32 value)
+        {
+            threshold = value;
+            return *this;
+        }
+
+        memory_budget_policy &set_allow_over_budget(bool value)
+        {
+            allow_over_budget = value;
+            return *this;
+        }
+
+        memory_budget_policy &set_on_pressure(pressure_callback &&value)
+        {
+            on_pressure = std::move(value);
+            return *this;
+        }
+    };
+
+    namespace detail
+    {
+        /// Apply the budget policy of the device to an allocation of the memory type.
+        /// @return True if the allocation may be retried without VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT
+        AGRB_EXPORT bool apply_memory_budget(const device &device, u32 memory_type, vk::DeviceSize size,
+                                             VmaAllocationCreateInfo &alloc_info);
+    } // namespace detail
+
+    /**
+     * @brief Run a VMA allocation under the budget policy of the device
+     * @param memory_type Memory type VMA would pick without the policy
+     * @param size Expected size of the allocation, 0 if unknown
+     * @param allocate Callable performing the allocation with the given VmaAllocationCreateInfo
+     */
+    template <typename Allocate>
+    VkResult allocate_within_budget(const device &device, u32 memory_type, vk::DeviceSize size,
+                                    VmaAllocationCreateInfo alloc_info, Allocate &&allocate)
+    {
+        bool retry = detail::apply_memory_budget(device, memory_type, size, alloc_info);
+        VkResult res = allocate(alloc_info);
+        if (res != VK_SUCCESS && retry)
+        {
+            alloc_info.flags &= ~VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+            res = allocate(alloc_info);
+        }
+        return res;
+    }
+} // namespace agrb
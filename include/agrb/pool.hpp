@@ -1,66 +1,120 @@
 #pragma once
 
-#include <acul/queue.hpp>
+#include <acul/scalars.hpp>
 #include <acul/vector.hpp>
+#include <algorithm>
+#include <cassert>
 
 namespace agrb
 {
+    /// @brief Occupancy statistics of a resource pool
+    struct pool_stats
+    {
+        size_t capacity = 0;   ///< Resources owned by the pool
+        size_t in_use = 0;     ///< Resources currently handed out
+        size_t high_water = 0; ///< Highest in_use since the pool was created or last shrunk
+    };
+
+    /// @brief Controls how many idle resources shrink() keeps
+    struct pool_shrink_policy
+    {
+        size_t min_capacity = 0; ///< Never shrink below this capacity
+        f32 headroom = 1.5f;     ///< Keep high_water * headroom resources
+
+        pool_shrink_policy &set_min_capacity(size_t value)
+        {
+            min_capacity = value;
+            return *this;
+        }
+
+        pool_shrink_policy &set_headroom(f32 value)
+        {
+            headroom = value;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Pool of reusable resources created through an allocation policy.
+     *
+     * Every resource lives in a fixed slot; request() hands out the slot indices as handles next to the values.
+     * Free slots are kept on a stack of indices, so releasing a handle is O(1), and bulk requests and releases
+     * move contiguous spans of that stack. The pool grows through Alloc::alloc when it runs out of free slots.
+     *
+     * The pool is not thread-safe.
+     */
     template <typename T, typename Alloc>
     class resource_pool
     {
     public:
+        using handle = u32;
+        static constexpr handle invalid_handle = UINT32_MAX;
+
         Alloc allocator;
 
         void allocate(size_t size)
         {
-            _size = size;
-            _pos = 0;
-            _data.resize(_size);
-            allocator.alloc(_data.data(), _size);
+            _data.resize(size);
+            allocator.alloc(_data.data(), size);
+            reset();
         }
 
         void destroy()
         {
             for (auto &data : _data) allocator.release(data);
             _data.clear();
-            _size = 0;
-            _pos = 0;
+            _free.clear();
+            _high_water = 0;
         }
 
-        void request(T *pData, size_t size)
+        /**
+         * @brief Request resources from the pool
+         * @param pData Destination of the resources
+         * @param size Number of resources
+         * @param pHandles Optional destination of the handles used to release the resources
+         */
+        void request(T *pData, size_t size, handle *pHandles = nullptr)
         {
-            int i = 0;
-            // Use available data
-            for (; size > 0 && _pos < _size; ++i, ++_pos, --size) pData[i] = _data[_pos];
-            if (size == 0) return;
-
-            // Use released buffers
-            while (size > 0 && !_released.empty())
+            // Take a contiguous span from the top of the free stack, in pop order
+            size_t reused = std::min(size, _free.size());
+            const handle *span = _free.data() + _free.size() - reused;
+            for (size_t i = 0; i < reused; ++i) pData[i] = _data[span[reused - 1 - i]];
+            if (pHandles) std::reverse_copy(span, span + reused, pHandles);
+            _free.resize(_free.size() - reused);
+            if (reused == size)
             {
-                size_t id = _released.front();
-                _released.pop();
-                pData[i++] = _data[id];
-                --size;
-            }
-            if (size > 0)
-            {
-                size_t old_size = _data.size();
-                _data.resize(old_size + size);
-                allocator.alloc(_data.data() + old_size, size);
-                std::copy_n(_data.data() + old_size, size, pData + i);
-                _size = _data.size();
-                _pos = _size;
+                update_high_water();
+                return;
             }
+
+            size_t missing = size - reused;
+            size_t old_size = _data.size();
+            _data.resize(old_size + missing);
+            allocator.alloc(_data.data() + old_size, missing);
+            std::copy_n(_data.data() + old_size, missing, pData + reused);
+            if (pHandles)
+                for (size_t i = 0; i < missing; ++i) pHandles[reused + i] = static_cast<handle>(old_size + i);
+            update_high_water();
         }
 
+        /// @brief Return a resource by its handle in O(1)
+        void release(handle id)
+        {
+            assert(id < _data.size());
+            _free.push_back(id);
+        }
+
+        /// @brief Return a span of handles
+        void release(const handle *pHandles, size_t size)
+        {
+            _free.insert(_free.end(), pHandles, pHandles + size);
+        }
+
+        /// @brief Return a resource by value. Linear in the pool size, prefer releasing by handle
         void release(T data)
         {
             auto it = std::find(_data.begin(), _data.end(), data);
-            if (it != _data.end())
-            {
-                size_t index = std::distance(_data.begin(), it);
-                _released.push(index);
-            }
+            if (it != _data.end()) release(static_cast<handle>(std::distance(_data.begin(), it)));
         }
 
         void release(T *pData, size_t size)
@@ -68,12 +122,55 @@ namespace agrb
             for (size_t i = 0; i < size; ++i) release(pData[i]);
         }
 
-        size_t size() const { return _size - _pos + _released.size(); }
+        /// @brief Make every resource available again, e.g. after the owning command pool has been reset
+        void reset()
+        {
+            _free.resize(_data.size());
+            // Descending, so that the lowest slots are handed out first
+            for (size_t i = 0; i < _data.size(); ++i) _free[i] = static_cast<handle>(_data.size() - 1 - i);
+        }
+
+        /**
+         * @brief Release idle resources beyond what the policy keeps.
+         * Handles stay stable, so only free slots at the end of the pool can be released. The high-water mark
+         * restarts from the current occupancy afterwards.
+         * @return Number of released resources
+         */
+        size_t shrink(const pool_shrink_policy &policy)
+        {
+            size_t in_use = _data.size() - _free.size();
+            size_t target = std::max(policy.min_capacity, static_cast<size_t>(_high_water * policy.headroom));
+            _high_water = in_use;
+            if (_data.size() <= target || _free.empty()) return 0;
+
+            acul::vector<bool> is_free(_data.size(), false);
+            for (handle id : _free) is_free[id] = true;
+            size_t new_size = _data.size();
+            while (new_size > target && is_free[new_size - 1]) allocator.release(_data[--new_size]);
+            size_t released = _data.size() - new_size;
+            if (released == 0) return 0;
+
+            _data.resize(new_size);
+            _free.erase(std::remove_if(_free.begin(), _free.end(), [new_size](handle id) { return id >= new_size; }),
+                        _free.end());
+            return released;
+        }
+
+        pool_stats stats() const { return {_data.size(), _data.size() - _free.size(), _high_water}; }
+
+        T &get(handle id) { return _data[id]; }
+
+        /// @brief Number of resources available without allocation
+        size_t size() const { return _free.size(); }
+
+        /// @brief Total number of resources owned by the pool
+        size_t capacity() const { return _data.size(); }
 
     private:
-        size_t _size = 0;
-        size_t _pos = 0;
         acul::vector<T> _data;
-        acul::queue<size_t> _released;
+        acul::vector<handle> _free;
+        size_t _high_water = 0;
+
+        void update_high_water() { _high_water = std::max(_high_water, _data.size() - _free.size()); }
     };
-} // namespace agrb
\ No newline at end of file
+} // namespace agrb
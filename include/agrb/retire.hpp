@@ -0,0 +1,146 @@
+#pragma once
+
+#include <acul/functional/unique_function.hpp>
+#include <acul/queue.hpp>
+#include <mutex>
+#include "texture.hpp"
+#include "utils/buffer.hpp"
+
+namespace agrb
+{
+    /**
+     * @brief Defers the destruction of GPU objects until the GPU has passed a timeline point.
+     *
+     * Objects are retired against the point of the last submission that may use them, e.g. exec_ticket::point(),
+     * frame_slot::submitted or current_point(). collect() reads every timeline once and destroys all objects whose
+     * point has been reached, so releasing resources no longer requires idling the device.
+     *
+     * Objects retired against an invalid point (devices without timeline semaphores) are only destroyed by flush().
+     * retire() may be called from any thread; collect() and flush() should be called from one thread.
+     */
+    class retire_queue
+    {
+    public:
+        explicit retire_queue(device &device) : _device(device) {}
+
+        retire_queue(const retire_queue &) = delete;
+        retire_queue &operator=(const retire_queue &) = delete;
+
+        ~retire_queue() { flush(); }
+
+        /// @brief Point covering every submission made to the queue so far.
+        /// Objects that are not referenced by commands still being recorded can be retired against it.
+        static timeline_point current_point(queue_family_info &queue)
+        {
+            if (!queue.timeline.valid()) return {};
+            return {&queue.timeline, queue.timeline.last_value.load()};
+        }
+
+        timeline_point current_point() const { return current_point(_device.rd->queues.graphics); }
+
+        void retire(const timeline_point &point, vk::Buffer buffer, VmaAllocation allocation = VK_NULL_HANDLE)
+        {
+            push(point, {vk::ObjectType::eBuffer, u64(VkBuffer(buffer)), allocation});
+        }
+
+        void retire(const timeline_point &point, vk::Image image, VmaAllocation allocation = VK_NULL_HANDLE)
+        {
+            push(point, {vk::ObjectType::eImage, u64(VkImage(image)), allocation});
+        }
+
+        void retire(const timeline_point &point, vk::ImageView view)
+        {
+            push(point, {vk::ObjectType::eImageView, u64(VkImageView(view))});
+        }
+
+        void retire(const timeline_point &point, vk::Sampler sampler)
+        {
+            push(point, {vk::ObjectType::eSampler, u64(VkSampler(sampler))});
+        }
+
+        void retire(const timeline_point &point, vk::Pipeline pipeline)
+        {
+            push(point, {vk::ObjectType::ePipeline, u64(VkPipeline(pipeline))});
+        }
+
+        void retire(const timeline_point &point, vk::Framebuffer framebuffer)
+        {
+            push(point, {vk::ObjectType::eFramebuffer, u64(VkFramebuffer(framebuffer))});
+        }
+
+        /// @brief Retire a descriptor set. The pool must be created with eFreeDescriptorSet
+        void retire(const timeline_point &point, vk::DescriptorPool pool, vk::DescriptorSet set)
+        {
+            push(point, {vk::ObjectType::eDescriptorSet, u64(VkDescriptorSet(set)), VK_NULL_HANDLE,
+                         u64(VkDescriptorPool(pool))});
+        }
+
+        /// @brief Run an arbitrary release callback once the point is reached
+        void retire(const timeline_point &point, acul::unique_function<void()> &&release)
+        {
+            retired_object object{vk::ObjectType::eUnknown, 0};
+            object.release = std::move(release);
+            push(point, std::move(object));
+        }
+
+        /// @brief Destroy every object whose point has been reached
+        /// @return Number of destroyed objects
+        AGRB_EXPORT size_t collect();
+
+        /// @brief Wait for all retire points and destroy every pending object
+        AGRB_EXPORT void flush();
+
+        size_t size() const { return _size; }
+
+    private:
+        struct retired_object
+        {
+            vk::ObjectType type;
+            u64 handle;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            u64 owner = 0;
+            acul::unique_function<void()> release;
+        };
+
+        struct retired_entry
+        {
+            u64 value;
+            retired_object object;
+        };
+
+        // Points of one timeline are retired in almost increasing order, so a FIFO per timeline is enough:
+        // an entry behind a larger value is only destroyed a little later.
+        struct timeline_bucket
+        {
+            queue_timeline *timeline;
+            acul::queue<retired_entry> entries;
+        };
+
+        device &_device;
+        std::mutex _lock;
+        acul::vector<timeline_bucket> _buckets;
+        acul::vector<retired_object> _untracked;
+        std::atomic<size_t> _size{0};
+
+        AGRB_EXPORT void push(const timeline_point &point, retired_object &&object);
+        void release(retired_object &object);
+    };
+
+    inline void retire_buffer(buffer &buffer, device &device, retire_queue &queue, const timeline_point &point)
+    {
+        unmap_buffer(buffer, device);
+        if (buffer.vk_buffer) queue.retire(point, buffer.vk_buffer, buffer.allocation);
+        buffer = {};
+    }
+
+    inline void retire_texture(texture &texture, retire_queue &queue, const timeline_point &point)
+    {
+        if (texture.sampler) queue.retire(point, texture.sampler);
+        if (texture.image_view) queue.retire(point, texture.image_view);
+        if (texture.image) queue.retire(point, texture.image, texture.allocation);
+        texture.sampler = nullptr;
+        texture.image_view = nullptr;
+        texture.image = nullptr;
+        texture.allocation = VK_NULL_HANDLE;
+    }
+} // namespace agrb
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "utils/buffer.hpp"
+#include "utils/mpsc_queue.hpp"
+
+namespace agrb
+{
+    /// @brief Work submitted through the submission_service
+    struct submit_job
+    {
+        /// Queue the commands are submitted to. The graphics queue if not set
+        queue_family_info *queue = nullptr;
+
+        /// Records the commands. Runs on the submit thread
+        acul::unique_function<void(single_time_exec &)> record;
+
+        /// Invoked on the submit thread once the GPU has executed the commands
+        acul::unique_function<void(vk::Result)> on_complete;
+    };
+
+    /**
+     * @brief Serializes all queue submissions of a device on a dedicated thread.
+     *
+     * Command pools, the fence pool and vk::Queue::submit are not thread-safe, so while the service is running
+     * the submit thread is their only user: other threads hand over jobs through a lock-free queue and are
+     * notified through the job callback or the returned future. Heavy CPU work such as filling staging memory
+     * stays on the producer thread, only command recording happens on the submit thread.
+     *
+     * single_time_exec must not be used on the device queues from other threads while the service is running.
+     */
+    class submission_service
+    {
+    public:
+        explicit submission_service(device &device) : _device(device) {}
+
+        submission_service(const submission_service &) = delete;
+        submission_service &operator=(const submission_service &) = delete;
+
+        ~submission_service() { stop(); }
+
+        /// @brief Start the submit thread
+        AGRB_EXPORT void start();
+
+        /// @brief Submit every pending job, wait for their completion and join the submit thread
+        AGRB_EXPORT void stop();
+
+        bool running() const { return _thread.joinable(); }
+
+        /// @brief Queue a job. Safe to call from any thread
+        /// @return Future receiving the submission result
+        AGRB_EXPORT std::future<vk::Result> submit(submit_job &&job);
+
+        /**
+         * Copies data to a GPU buffer from the calling thread and submits the recorded commands through the service.
+         * Host visible allocations are written directly. Otherwise the payload is written into a staging buffer
+         * that is destroyed once the submission completes, so the source data may be released right after the call.
+         * Uploads are always recorded on the graphics queue; on_ownership_transfer is not used.
+         * @param[in] upload_info Information about the upload.
+         * @param[in] on_complete Optional completion callback invoked on the submit thread.
+         * @return Future receiving the submission result, or vk::Result::eErrorOutOfDeviceMemory if the payload
+         * could not be written.
+         */
+        AGRB_EXPORT std::future<vk::Result> upload(gpu_upload_info &&upload_info,
+                                                   acul::unique_function<void(vk::Result)> &&on_complete = {});
+
+    private:
+        struct pending_job
+        {
+            submit_job job;
+            std::promise<vk::Result> promise;
+        };
+
+        device &_device;
+        mpsc_queue<pending_job> _jobs;
+        std::thread _thread;
+        std::atomic<bool> _stop{false};
+        std::atomic<bool> _idle{false};
+        std::mutex _wake_lock;
+        std::condition_variable _wake;
+
+        void run();
+        void notify();
+    };
+} // namespace agrb
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <mutex>
+#include "device.hpp"
+
+namespace agrb
+{
+    /// @brief Semaphore wait or signal operation of a batched submission
+    struct semaphore_submit
+    {
+        vk::Semaphore semaphore;
+        u64 value = 0; ///< Ignored for binary semaphores
+        vk::PipelineStageFlags2 stage = vk::PipelineStageFlagBits2::eAllCommands;
+    };
+
+    /// @brief Work of one producer: command buffers plus the semaphores they wait on and signal
+    struct batch_submission
+    {
+        acul::vector<vk::CommandBuffer> command_buffers;
+        acul::vector<semaphore_submit> waits;
+        acul::vector<semaphore_submit> signals;
+
+        batch_submission &add_command_buffer(vk::CommandBuffer command_buffer)
+        {
+            command_buffers.push_back(command_buffer);
+            return *this;
+        }
+
+        batch_submission &wait(vk::Semaphore semaphore, vk::PipelineStageFlags2 stage, u64 value = 0)
+        {
+            waits.push_back({semaphore, value, stage});
+            return *this;
+        }
+
+        batch_submission &wait(const timeline_point &point, vk::PipelineStageFlags2 stage)
+        {
+            return wait(point.timeline->semaphore, stage, point.value);
+        }
+
+        batch_submission &signal(vk::Semaphore semaphore, u64 value = 0,
+                                 vk::PipelineStageFlags2 stage = vk::PipelineStageFlagBits2::eAllCommands)
+        {
+            signals.push_back({semaphore, value, stage});
+            return *this;
+        }
+    };
+
+    struct submit_batch_stats
+    {
+        u32 submissions = 0;   ///< Submissions added by producers
+        u32 submit_infos = 0;  ///< Submit infos after merging submissions without dependencies in between
+        u32 queue_submits = 0; ///< Driver submit calls
+
+        /// @brief Number of submit calls saved by batching
+        u32 merged() const { return submissions - queue_submits; }
+    };
+
+    /**
+     * @brief Reduce synchronization2 stages to the legacy stages covering them, for vkQueueSubmit.
+     * The low 32 bits share their values with the legacy flags. Split stages such as eCopy or eIndexInput map to
+     * the legacy stage that contains them, any other extended stage to eAllCommands.
+     * @param features Enabled features. ePreRasterizationShaders only expands to the tessellation and geometry
+     * stages whose features are enabled, other stage bits would be invalid in the legacy mask
+     */
+    inline vk::PipelineStageFlags to_legacy_stages(vk::PipelineStageFlags2 stages,
+                                                   const enabled_device_features &features = {})
+    {
+        using stage2 = vk::PipelineStageFlagBits2;
+        const auto value = static_cast<VkPipelineStageFlags2>(stages);
+        vk::PipelineStageFlags legacy(static_cast<VkPipelineStageFlags>(value & 0xFFFFFFFFull));
+        vk::PipelineStageFlags2 extended(value & ~0xFFFFFFFFull);
+        if (!extended) return legacy ? legacy : vk::PipelineStageFlagBits::eAllCommands;
+
+        const vk::PipelineStageFlags2 transfer = stage2::eCopy | stage2::eResolve | stage2::eBlit | stage2::eClear;
+        const vk::PipelineStageFlags2 vertex_input = stage2::eIndexInput | stage2::eVertexAttributeInput;
+        if (extended & transfer) legacy |= vk::PipelineStageFlagBits::eTransfer;
+        if (extended & vertex_input) legacy |= vk::PipelineStageFlagBits::eVertexInput;
+        if (extended & stage2::ePreRasterizationShaders)
+        {
+            legacy |= vk::PipelineStageFlagBits::eVertexShader;
+            if (features.tessellation_shader)
+                legacy |= vk::PipelineStageFlagBits::eTessellationControlShader |
+                          vk::PipelineStageFlagBits::eTessellationEvaluationShader;
+            if (features.geometry_shader) legacy |= vk::PipelineStageFlagBits::eGeometryShader;
+        }
+        // Anything else has no legacy equivalent, wait conservatively
+        if (extended & ~(transfer | vertex_input | stage2::ePreRasterizationShaders))
+            return vk::PipelineStageFlagBits::eAllCommands;
+        return legacy;
+    }
+
+    /**
+     * @brief Collects submissions from several producers and flushes them with one submit call per queue.
+     *
+     * Consecutive submissions to the same queue are folded into one submit info when the earlier one signals
+     * nothing and the later one waits for nothing. flush() uses vkQueueSubmit2 when synchronization2 is enabled
+     * and falls back to vkQueueSubmit otherwise, in which case stage masks are reduced to the legacy stage bits.
+     *
+     * Queues are flushed in the order they first received work. Binary semaphores must therefore be signaled by
+     * a queue that was added before the one waiting on them; timeline semaphores may be waited on in any order.
+     * add() and signal_fence() may be called from any thread.
+     */
+    class submit_batch
+    {
+    public:
+        explicit submit_batch(device &device) : _device(device) {}
+
+        /// @brief Queue a submission for the next flush
+        AGRB_EXPORT void add(queue_family_info &queue, batch_submission &&submission);
+
+        /// @brief Signal a fence once the queue's part of the next flush completes
+        AGRB_EXPORT void signal_fence(queue_family_info &queue, vk::Fence fence);
+
+        /// @brief Submit all queued work
+        /// @return First error returned by the driver, vk::Result::eSuccess otherwise
+        AGRB_EXPORT vk::Result flush();
+
+        /// @brief Statistics of the last flush
+        const submit_batch_stats &stats() const { return _stats; }
+
+    private:
+        struct queue_batch
+        {
+            queue_family_info *queue = nullptr;
+            acul::vector<batch_submission> submissions;
+            vk::Fence fence;
+        };
+
+        device &_device;
+        std::mutex _lock;
+        acul::vector<queue_batch> _queues;
+        submit_batch_stats _stats;
+
+        queue_batch &get_batch(queue_family_info &queue);
+        vk::Result submit2(queue_batch &batch);
+        vk::Result submit(queue_batch &batch);
+    };
+} // namespace agrb
@@ -45,17 +45,56 @@ namespace agrb
     /// @param alloc_info Allocation info
     /// @param allocation: Allocation for the buffer
     /// @param device Device
-    /// @return True on success, false on failure
+    /// @return True on success, false on failure. Fails for eShaderDeviceAddress usage unless the device has
+    /// enabled_device_features::buffer_device_address
     AGRB_EXPORT bool create_buffer(vk::DeviceSize size, vk::BufferUsageFlags vk_usage, vk::Buffer &buffer,
                                   VmaAllocationCreateInfo alloc_info, VmaAllocation &allocation, const device &device);
 
+    /**
+     * @brief Allocation info for resources written by the host once and read by the device.
+     * Prefers device local memory the host can write directly (UMA, resizable BAR), in which case the allocation
+     * is persistently mapped and the upload functions write it without staging and without a command buffer.
+     * Otherwise the allocation is device local only and uploads go through staging as usual.
+     */
+    inline VmaAllocationCreateInfo make_direct_write_alloc_info(const device_runtime_data &rd, f32 priority = 0.5f)
+    {
+        if (!rd.direct_write_memory_types())
+            return make_alloc_info(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {}, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                   priority);
+        auto alloc_info = make_alloc_info(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {},
+                                          vk::MemoryPropertyFlagBits::eDeviceLocal |
+                                              vk::MemoryPropertyFlagBits::eHostVisible,
+                                          priority);
+        alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                           VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT |
+                           VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        return alloc_info;
+    }
+
+    /// @brief Query the GPU address of a buffer created with eShaderDeviceAddress
+    inline vk::DeviceAddress get_buffer_device_address(vk::Buffer buffer, device &device)
+    {
+        return device.vk_device.getBufferAddress(vk::BufferDeviceAddressInfo{buffer}, device.loader);
+    }
+
     inline bool allocate_buffer(buffer &buffer, VmaAllocationCreateInfo alloc_info, vk::BufferUsageFlags usage_flags,
                                 device &device)
     {
         assert(buffer.buffer_size > 0);
-        return create_buffer(buffer.buffer_size, usage_flags, buffer.vk_buffer, alloc_info, buffer.allocation, device);
+        if (!create_buffer(buffer.buffer_size, usage_flags, buffer.vk_buffer, alloc_info, buffer.allocation, device))
+            return false;
+        if (usage_flags & vk::BufferUsageFlagBits::eShaderDeviceAddress)
+            buffer.address = get_buffer_device_address(buffer.vk_buffer, device);
+        return true;
     }
 
+    /// @brief Create a host visible staging buffer and map it
+    /// @param staging Destination buffer
+    /// @param size Size of the buffer in bytes
+    /// @param device Device
+    /// @return True on success, false on failure
+    AGRB_EXPORT bool create_staging_buffer(buffer &staging, vk::DeviceSize size, device &device);
+
     /**
      * Copies the specified data to the mapped buffer. Default value writes whole buffer range
      *
@@ -70,12 +109,16 @@ namespace agrb
     {
         assert(buffer.mapped);
         if (size == VK_WHOLE_SIZE)
+        {
             memcpy(buffer.mapped, data, buffer.buffer_size);
+            if (buffer.dirty_ranges) buffer.dirty_ranges->mark(0, buffer.buffer_size);
+        }
         else
         {
             char *mem_offset = static_cast<char *>(buffer.mapped);
             mem_offset += offset;
             memcpy(mem_offset, data, size);
+            if (buffer.dirty_ranges) buffer.dirty_ranges->mark(offset, size);
         }
     }
 
@@ -91,12 +134,16 @@ namespace agrb
     {
         assert(buffer.mapped && data);
         if (size == VK_WHOLE_SIZE)
+        {
             memmove(buffer.mapped, data, buffer.buffer_size);
+            if (buffer.dirty_ranges) buffer.dirty_ranges->mark(0, buffer.buffer_size);
+        }
         else
         {
             char *mem_offset = static_cast<char *>(buffer.mapped);
             mem_offset += offset;
             memmove(mem_offset, data, size);
+            if (buffer.dirty_ranges) buffer.dirty_ranges->mark(offset, size);
         }
     }
 
@@ -112,9 +159,18 @@ namespace agrb
         write_to_buffer(buffer, data, instance_size, index * buffer.alignment_size);
     }
 
+    // Resolve a range relative to the buffer into a range of its allocation. VK_WHOLE_SIZE never reaches
+    // past the buffer: a sub-allocated range at offset 0 shares vk_buffer with its neighbours.
+    inline void resolve_buffer_range(const buffer &buffer, vk::DeviceSize &size, vk::DeviceSize &offset)
+    {
+        if (size == VK_WHOLE_SIZE && buffer.buffer_size) size = buffer.buffer_size - offset;
+        offset += buffer.offset;
+    }
+
     inline vk::Result flush_buffer(buffer &buffer, device &device, vk::DeviceSize size = VK_WHOLE_SIZE,
                                    vk::DeviceSize offset = 0)
     {
+        resolve_buffer_range(buffer, size, offset);
         return (vk::Result)vmaFlushAllocation(device.allocator, buffer.allocation, offset, size);
     }
     /**
@@ -128,6 +184,32 @@ namespace agrb
         return flush_buffer(buffer, device, buffer.alignment_size, index * buffer.alignment_size);
     }
 
+    /**
+     * Enable dirty range tracking on an allocated buffer. Writes made with write_to_buffer(), move_to_buffer()
+     * and write_to_buffer_index() are recorded and flushed at once by flush_dirty_ranges().
+     * Nothing is recorded if the buffer memory is host coherent.
+     */
+    inline void track_dirty_ranges(buffer &buffer, device &device)
+    {
+        assert(buffer.allocation);
+        if (!buffer.dirty_ranges) buffer.dirty_ranges = acul::make_shared<dirty_range_tracker>();
+        buffer.dirty_ranges->atom_size = device.rd->properties2.properties.limits.nonCoherentAtomSize;
+        auto mem_flags = get_allocation_memory_flags(device.allocator, buffer.allocation);
+        buffer.dirty_ranges->coherent = static_cast<bool>(mem_flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    /**
+     * Flush the dirty ranges of several buffers with a single vmaFlushAllocations call and clear them.
+     * Buffers without tracking or in coherent memory are skipped.
+     */
+    AGRB_EXPORT vk::Result flush_dirty_ranges(device &device, buffer *const *buffers, size_t count);
+
+    inline vk::Result flush_dirty_ranges(device &device, buffer &buffer)
+    {
+        agrb::buffer *buffers[] = {&buffer};
+        return flush_dirty_ranges(device, buffers, 1);
+    }
+
     /**
      * Invalidate a memory range of the buffer to make it visible to the host
      *
@@ -142,6 +224,7 @@ namespace agrb
     inline vk::Result invalidate_buffer(buffer &buffer, device &device, vk::DeviceSize size = VK_WHOLE_SIZE,
                                         vk::DeviceSize offset = 0)
     {
+        resolve_buffer_range(buffer, size, offset);
         return (vk::Result)vmaInvalidateAllocation(device.allocator, buffer.allocation, offset, size);
     }
 
@@ -159,11 +242,24 @@ namespace agrb
         return invalidate_buffer(buffer, device, buffer.alignment_size, index * buffer.alignment_size);
     }
 
+    /// @brief Describe a range of the buffer for a descriptor write
+    /// @param size Size of the range. VK_WHOLE_SIZE covers the buffer up to its end
+    /// @param offset Offset of the range relative to the buffer
+    inline vk::DescriptorBufferInfo get_descriptor_info(const buffer &buffer, vk::DeviceSize size = VK_WHOLE_SIZE,
+                                                        vk::DeviceSize offset = 0)
+    {
+        resolve_buffer_range(buffer, size, offset);
+        return {buffer.vk_buffer, offset, size};
+    }
+
     struct buffer_mem_cache : public acul::mem_cache
     {
         explicit buffer_mem_cache(buffer &buffer, device &device)
             : acul::mem_cache{[this, &device]() { destroy_buffer(this->_buffer, device); }},
-              _buffer{.mapped = buffer.mapped, .vk_buffer = buffer.vk_buffer, .allocation = buffer.allocation}
+              _buffer{.mapped = buffer.mapped,
+                      .vk_buffer = buffer.vk_buffer,
+                      .allocation = buffer.allocation,
+                      .dirty_ranges = std::move(buffer.dirty_ranges)}
         {
             buffer = {};
         }
@@ -178,10 +274,12 @@ namespace agrb
     /// @param src_buffer Source buffer
     /// @param dst_buffer Destination buffer
     /// @param size Size of the buffer
+    /// @param src_offset Offset in the source buffer
+    /// @param dst_offset Offset in the destination buffer
     inline void copy_buffer(single_time_exec &exec, device &device, vk::Buffer src_buffer, vk::Buffer dst_buffer,
-                            vk::DeviceSize size)
+                            vk::DeviceSize size, vk::DeviceSize src_offset = 0, vk::DeviceSize dst_offset = 0)
     {
-        vk::BufferCopy copy_region(0, 0, size);
+        vk::BufferCopy copy_region(src_offset, dst_offset, size);
         exec.command_buffer.copyBuffer(src_buffer, dst_buffer, 1, &copy_region, exec.loader);
     }
 
@@ -197,16 +295,59 @@ namespace agrb
         exec.end();
     }
 
+    /**
+     * Records one side of a queue family ownership transfer of a buffer range.
+     * The same call must be recorded on both queues: the releasing queue makes its transfer writes available,
+     * the acquiring queue makes them visible to all subsequent commands.
+     * @param exec Execution context of either queue
+     * @param ownership Releasing and acquiring queue families
+     * @param buffer Buffer to transfer
+     * @param size Size of the range
+     * @param offset Offset of the range
+     * @param src_access Writes made available by the releasing queue
+     * @param src_stage Stages of the releasing queue performing the writes
+     */
+    inline void buffer_ownership_barrier(single_time_exec &exec, const queue_ownership &ownership, vk::Buffer buffer,
+                                         vk::DeviceSize size = VK_WHOLE_SIZE, vk::DeviceSize offset = 0,
+                                         vk::AccessFlags src_access = vk::AccessFlagBits::eTransferWrite,
+                                         vk::PipelineStageFlags src_stage = vk::PipelineStageFlagBits::eTransfer)
+    {
+        vk::BufferMemoryBarrier barrier;
+        barrier.setSrcQueueFamilyIndex(ownership.src_family)
+            .setDstQueueFamilyIndex(ownership.dst_family)
+            .setBuffer(buffer)
+            .setOffset(offset)
+            .setSize(size);
+        if (exec.is_releasing(ownership))
+        {
+            barrier.setSrcAccessMask(src_access);
+            exec.command_buffer.pipelineBarrier(src_stage, vk::PipelineStageFlagBits::eBottomOfPipe, {}, 0, nullptr,
+                                                1, &barrier, 0, nullptr, exec.loader);
+        }
+        else
+        {
+            barrier.setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+            exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                                vk::PipelineStageFlagBits::eAllCommands, {}, 0, nullptr, 1, &barrier, 0,
+                                                nullptr, exec.loader);
+        }
+    }
+
     struct gpu_upload_info
     {
-        VmaAllocation allocation;
+        VmaAllocation allocation = VK_NULL_HANDLE;
         vk::DeviceSize size;
+        /// Offset of the destination inside the allocation, e.g. buffer::offset of a buffer_arena range
+        vk::DeviceSize offset = 0;
         void *data = nullptr;
         buffer* staging = nullptr;
 
         acul::unique_function<void(single_time_exec &exec, bool)> on_upload;
         acul::unique_function<void(single_time_exec &, struct buffer &)> on_copy_staging;
         acul::unique_function<bool(void *, vk::DeviceSize)> on_staging_request;
+        /// Records the ownership barriers of the destination resource. When it is set and the device exposes
+        /// a dedicated transfer queue, on_copy_staging runs there and on_upload runs on the graphics queue.
+        acul::unique_function<void(single_time_exec &, const queue_ownership &)> on_ownership_transfer;
 
         bool valid() const { return data && size > 0; }
     };
@@ -215,7 +356,8 @@ namespace agrb
     make_copy_buffer_callback(device &device, buffer &dst_buffer, vk::DeviceSize size)
     {
         return [&device, &dst_buffer, size](single_time_exec &exec, buffer &staging) {
-            copy_buffer(exec, device, staging.vk_buffer, dst_buffer.vk_buffer, size);
+            copy_buffer(exec, device, staging.vk_buffer, dst_buffer.vk_buffer, size, staging.offset,
+                        dst_buffer.offset);
         };
     }
 
@@ -223,7 +365,19 @@ namespace agrb
     make_move_buffer_callback(device &device, buffer &dst_buffer, vk::DeviceSize size)
     {
         return [&device, &dst_buffer, size](single_time_exec &exec, buffer &staging) {
-            copy_buffer(exec, device, staging.vk_buffer, dst_buffer.vk_buffer, size);
+            copy_buffer(exec, device, staging.vk_buffer, dst_buffer.vk_buffer, size, staging.offset,
+                        dst_buffer.offset);
+        };
+    }
+
+    inline acul::unique_function<void(single_time_exec &, const queue_ownership &)>
+    make_buffer_ownership_callback(buffer &dst_buffer, vk::DeviceSize size = VK_WHOLE_SIZE)
+    {
+        return [&dst_buffer, size](single_time_exec &exec, const queue_ownership &ownership) {
+            // Only the buffer's own range is transferred, a suballocation shares its vk::Buffer with other ranges
+            vk::DeviceSize range_size = size, range_offset = 0;
+            resolve_buffer_range(dst_buffer, range_size, range_offset);
+            buffer_ownership_barrier(exec, ownership, dst_buffer.vk_buffer, range_size, range_offset);
         };
     }
 
@@ -237,13 +391,15 @@ namespace agrb
      * @return True if the upload was successful, false otherwise.
      */
     AGRB_EXPORT bool copy_data_to_gpu_buffer_host_visible(const gpu_upload_info &upload_info, VmaAllocator &allocator,
-                                              VkMemoryPropertyFlags mem_flags);
+                                                          vk::MemoryPropertyFlags mem_flags);
 
     /**
      * Copies data to GPU buffer using a staging buffer.
-     * Itt creates a staging buffer,
+     * The staging range is sub-allocated from device_runtime_data::staging when it is set and has room,
+     * otherwise it creates a staging buffer,
      * maps it, copies the data to the staging buffer, unmaps the staging buffer,
      * and then uses the staging buffer as a source of transfer to the buffer described previously.
+     * on_copy_staging must honor buffer::offset of the staging buffer.
      * @param[in] upload_info Information about the upload.
      * @param[in] device The device to use for the upload.
      * @return True if the upload was successful, false otherwise.
@@ -270,13 +426,15 @@ namespace agrb
      * @return True if the upload was successful, false otherwise.
      */
     bool move_data_to_gpu_buffer_host_visible(const gpu_upload_info &upload_info, VmaAllocator &allocator,
-                                              VkMemoryPropertyFlags mem_flags);
+                                              vk::MemoryPropertyFlags mem_flags);
 
     /**
      * Copies data to GPU buffer using a staging buffer.
-     * Itt creates a staging buffer,
+     * The staging range is sub-allocated from device_runtime_data::staging when it is set and has room,
+     * otherwise it creates a staging buffer,
      * maps it, copies the data to the staging buffer, unmaps the staging buffer,
      * and then uses the staging buffer as a source of transfer to the buffer described previously.
+     * on_copy_staging must honor buffer::offset of the staging buffer.
      * @param[in] upload_info Information about the upload.
      * @param[in] device The device to use for the upload.
      * @return True if the upload was successful, false otherwise.
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "buffer.hpp"
+
+namespace agrb
+{
+    /// @brief Get the queue compute work is submitted to: the compute family if the device exposes one with a
+    /// command pool, the graphics queue otherwise. init_device() prefers a compute family without graphics
+    inline queue_family_info &get_compute_queue(device &device)
+    {
+        auto &queues = device.rd->queues;
+        if (queues.compute.vk_queue && queues.compute.pool.vk_pool) return queues.compute;
+        return queues.graphics;
+    }
+
+    /**
+     * @brief Execution context that records compute work for the compute queue.
+     *
+     * On GPUs with a separate compute family the work runs asynchronously to rendering. end_async() returns a
+     * ticket whose point() is signaled on the compute timeline; pass it to single_time_exec::wait_for(),
+     * frame_controller::wait_for() or batch_submission::wait() so the consumer waits on the GPU instead of the host.
+     * Resources written here and read by the graphics queue need a queue family ownership transfer when
+     * is_async() is true, see graphics_ownership() and buffer_ownership_barrier().
+     */
+    struct compute_exec : single_time_exec
+    {
+        queue_family_info &graphics_queue;
+
+        explicit compute_exec(device &device)
+            : single_time_exec(device, get_compute_queue(device)), graphics_queue(device.rd->queues.graphics)
+        {
+        }
+
+        /// @brief Check whether the work runs on a queue family different from the graphics one
+        bool is_async() const { return queue.family_id != graphics_queue.family_id; }
+
+        /**
+         * @brief Bind a pipeline created by a compute_pipeline_batch and dispatch it
+         * @param pipeline Compute pipeline
+         * @param layout Layout the pipeline was created with
+         * @param sets Descriptor sets bound starting at set 0
+         * @param set_count Number of descriptor sets
+         * @param group_count_x Number of workgroups in X
+         * @param group_count_y Number of workgroups in Y
+         * @param group_count_z Number of workgroups in Z
+         */
+        void dispatch(vk::Pipeline pipeline, vk::PipelineLayout layout, const vk::DescriptorSet *sets, u32 set_count,
+                      u32 group_count_x, u32 group_count_y = 1, u32 group_count_z = 1)
+        {
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline, loader);
+            if (set_count > 0)
+                command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, 0, set_count, sets, 0,
+                                                  nullptr, loader);
+            command_buffer.dispatch(group_count_x, group_count_y, group_count_z, loader);
+        }
+
+        /// @brief Ownership transfer of resources produced here and consumed by the graphics queue
+        queue_ownership graphics_ownership() const
+        {
+            return {queue.family_id.value(), graphics_queue.family_id.value()};
+        }
+    };
+
+    /**
+     * Records one side of the ownership transfer of a buffer written by compute shaders.
+     * @param exec Execution context of either queue
+     * @param ownership Releasing and acquiring queue families
+     * @param buffer Buffer to transfer
+     * @param size Size of the range
+     * @param offset Offset of the range
+     */
+    inline void compute_buffer_ownership_barrier(single_time_exec &exec, const queue_ownership &ownership,
+                                                 vk::Buffer buffer, vk::DeviceSize size = VK_WHOLE_SIZE,
+                                                 vk::DeviceSize offset = 0)
+    {
+        buffer_ownership_barrier(exec, ownership, buffer, size, offset, vk::AccessFlagBits::eShaderWrite,
+                                 vk::PipelineStageFlagBits::eComputeShader);
+    }
+} // namespace agrb
@@ -1,29 +1,176 @@
 #pragma once
 
+#include <acul/functional/unique_function.hpp>
+#include <acul/memory/smart_ptr.hpp>
+#include <atomic>
+#include <mutex>
 #include "../device.hpp"
 
 namespace agrb
 {
+    namespace detail
+    {
+        struct exec_ticket_state
+        {
+            vk::Device *vk_device = nullptr;
+            queue_family_info *queue = nullptr;
+            resource_pool<vk::Fence, fence_pool_alloc> *fence_pool = nullptr;
+            vk::DispatchLoaderDynamic *loader = nullptr;
+            vk::CommandBuffer command_buffer;
+            primary_command_buffer_pool::handle command_buffer_id = primary_command_buffer_pool::invalid_handle;
+            vk::Fence fence;
+            fence_resource_pool::handle fence_id = fence_resource_pool::invalid_handle;
+            timeline_point point;
+            std::atomic<vk::Result> result{vk::Result::eNotReady};
+            acul::vector<acul::unique_function<void(vk::Result)>> callbacks;
+            /// Serializes completion: copies of a ticket may be polled and waited on from several threads
+            std::mutex lock;
+
+            bool completed() const { return result.load(std::memory_order_acquire) != vk::Result::eNotReady; }
+
+            /// Poll the submission, completing the state once the GPU is done. Never blocks: returns false
+            /// while another thread is completing the state
+            AGRB_EXPORT bool poll();
+
+            /// Block on the submission, completing the state unless the timeout expires
+            AGRB_EXPORT vk::Result wait(u64 timeout);
+
+            /// Register a callback, or invoke it right away if the state is already completed
+            AGRB_EXPORT void add_callback(acul::unique_function<void(vk::Result)> &&callback);
+
+            /// Release the command buffer and the fence exactly once. Must be called with the lock held;
+            /// returns the callbacks to invoke once the lock is released
+            acul::vector<acul::unique_function<void(vk::Result)>> complete(vk::Result res);
+
+            ~exec_ticket_state()
+            {
+                // The command buffer and the fence must not be returned to their pools while the GPU may still use
+                // them, so an abandoned ticket has to wait for its submission here.
+                if (!completed() && command_buffer) wait(UINT64_MAX);
+            }
+        };
+    } // namespace detail
+
+    /**
+     * @brief Completion handle of an asynchronous single_time_exec submission.
+     *
+     * The command buffer and the fence of the submission are returned to their pools only once the ticket
+     * observes completion through ready() or wait(). Copies of a ticket share the same submission state.
+     * On devices with timeline semaphores the submission signals the queue timeline instead of a pooled fence,
+     * and point() can be used as a GPU-side dependency of a submission on another queue.
+     */
+    class exec_ticket
+    {
+    public:
+        exec_ticket() = default;
+
+        /// @brief Check whether the ticket refers to a submission
+        bool valid() const { return _state != nullptr; }
+
+        /// @brief Poll the submission without blocking
+        /// @return True if the GPU has finished executing the submission
+        AGRB_EXPORT bool ready();
+
+        /// @brief Block until the submission completes or the timeout expires
+        /// @param timeout Timeout in nanoseconds
+        /// @return vk::Result::eTimeout if the submission is still pending, otherwise the submission result
+        AGRB_EXPORT vk::Result wait(u64 timeout = UINT64_MAX);
+
+        /// @brief Register a callback invoked once the submission completes.
+        /// If the submission has already completed, the callback is invoked immediately.
+        /// @param callback Callback receiving the submission result
+        AGRB_EXPORT void then(acul::unique_function<void(vk::Result)> &&callback);
+
+        /// @brief Get the submission result. vk::Result::eNotReady while the submission is pending
+        vk::Result result() const { return _state ? _state->result.load() : vk::Result::eNotReady; }
+
+        /// @brief Get the timeline point signaled by the submission. Invalid for fence based submissions
+        timeline_point point() const { return _state ? _state->point : timeline_point{}; }
+
+    private:
+        acul::shared_ptr<detail::exec_ticket_state> _state;
+
+        friend struct single_time_exec;
+    };
+
     struct single_time_exec
     {
         vk::CommandBuffer command_buffer;
+        primary_command_buffer_pool::handle command_buffer_id = primary_command_buffer_pool::invalid_handle;
         vk::Device &vk_device;
         queue_family_info &queue;
         resource_pool<vk::Fence, fence_pool_alloc> &fence_pool;
         vk::DispatchLoaderDynamic &loader;
+        bool external = false;
 
-        single_time_exec(device &device)
-            : vk_device(device.vk_device),
-              queue(device.rd->queues.graphics),
-              fence_pool(device.rd->fence_pool),
-              loader(device.loader)
+        single_time_exec(device &device) : single_time_exec(device, device.rd->queues.graphics) {}
+
+        /// @brief Record commands for the specified queue, e.g. the dedicated transfer queue
+        single_time_exec(device &device, queue_family_info &queue)
+            : vk_device(device.vk_device), queue(queue), fence_pool(device.rd->fence_pool), loader(device.loader)
         {
-            queue.pool.primary.request(&command_buffer, 1);
+            queue.pool.primary.request(&command_buffer, 1, &command_buffer_id);
             vk::CommandBufferBeginInfo begin_info;
             begin_info.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
             command_buffer.begin(begin_info, loader);
         }
 
+        /// @brief Wrap a command buffer that is already recording, e.g. the command buffer of the current frame.
+        /// The owner of the command buffer submits it, so end() and end_async() must not be called on the wrapper.
+        single_time_exec(device &device, vk::CommandBuffer command_buffer)
+            : command_buffer(command_buffer),
+              vk_device(device.vk_device),
+              queue(device.rd->queues.graphics),
+              fence_pool(device.rd->fence_pool),
+              loader(device.loader),
+              external(true)
+        {
+        }
+
+        /// @brief Submit the recorded commands and block until the GPU has executed them
         AGRB_EXPORT vk::Result end();
+
+        /// @brief Submit the recorded commands without waiting for the GPU
+        /// @return Ticket that owns the command buffer and the fence until the submission completes.
+        /// If the submission fails, the resources are released right away and the vk::SystemError is rethrown
+        AGRB_EXPORT exec_ticket end_async();
+
+        /**
+         * @brief Make the submission wait until another queue reaches a timeline point
+         * @param point Timeline point to wait for, e.g. exec_ticket::point() of a transfer submission
+         * @param stage Pipeline stages that must not start before the point is reached
+         */
+        void wait_for(const timeline_point &point, vk::PipelineStageFlags stage)
+        {
+            assert(point.valid() && queue.timeline.valid());
+            _wait_semaphores.push_back(point.timeline->semaphore);
+            _wait_values.push_back(point.value);
+            _wait_stages.push_back(stage);
+        }
+
+        /**
+         * @brief Order the submission after another asynchronous submission.
+         * The dependency is resolved on the GPU when both queues have timelines, otherwise the host waits
+         * for the ticket. The ticket must be kept alive until this submission completes.
+         */
+        void wait_for(exec_ticket &ticket, vk::PipelineStageFlags stage)
+        {
+            auto point = ticket.point();
+            if (point.valid() && queue.timeline.valid())
+                wait_for(point, stage);
+            else
+                ticket.wait();
+        }
+
+        /// @brief Check whether the commands are recorded on the releasing side of an ownership transfer
+        bool is_releasing(const queue_ownership &ownership) const
+        {
+            return queue.family_id.value() == ownership.src_family;
+        }
+
+    private:
+        acul::vector<vk::Semaphore> _wait_semaphores;
+        acul::vector<u64> _wait_values;
+        acul::vector<vk::PipelineStageFlags> _wait_stages;
     };
-} // namespace agrb
\ No newline at end of file
+} // namespace agrb
@@ -11,10 +11,11 @@
 namespace agrb
 {
     inline void copy_buffer_to_image(single_time_exec &exec, vk::Buffer buffer, vk::Image image, u32 layer_count,
-                                     vk::Extent3D image_extent, vk::Offset3D image_offset = {0, 0, 0})
+                                     vk::Extent3D image_extent, vk::Offset3D image_offset = {0, 0, 0},
+                                     vk::DeviceSize buffer_offset = 0)
     {
         vk::BufferImageCopy region{};
-        region.setBufferOffset(0)
+        region.setBufferOffset(buffer_offset)
             .setBufferRowLength(0)
             .setBufferImageHeight(0)
             .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, layer_count})
@@ -49,6 +50,45 @@ namespace agrb
         return exec.end();
     }
 
+    /**
+     * @brief Record one side of a queue family ownership transfer of an image.
+     *
+     * The same call must be recorded on both queues. The layout is kept, so the acquiring queue continues
+     * from the layout the releasing queue left the image in.
+     *
+     * @param exec Execution context of either queue
+     * @param ownership Releasing and acquiring queue families
+     * @param image Image to transfer
+     * @param layout Current image layout
+     * @param mip_levels Image mip levels
+     * @param layer_count Image layer count
+     */
+    inline void image_ownership_barrier(single_time_exec &exec, const queue_ownership &ownership, vk::Image image,
+                                        vk::ImageLayout layout, u32 mip_levels, u32 layer_count = 1)
+    {
+        vk::ImageMemoryBarrier barrier{};
+        barrier.setOldLayout(layout)
+            .setNewLayout(layout)
+            .setSrcQueueFamilyIndex(ownership.src_family)
+            .setDstQueueFamilyIndex(ownership.dst_family)
+            .setImage(image)
+            .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, mip_levels, 0, layer_count});
+        if (exec.is_releasing(ownership))
+        {
+            barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+            exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                                vk::PipelineStageFlagBits::eBottomOfPipe, {}, 0, nullptr, 0, nullptr,
+                                                1, &barrier, exec.loader);
+        }
+        else
+        {
+            barrier.setDstAccessMask(vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+            exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                                vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1,
+                                                &barrier, exec.loader);
+        }
+    }
+
     /// @brief Copy image to vk buffer
     /// @param device Device
     /// @param buffer Source buffer
@@ -90,6 +130,13 @@ namespace agrb
                               reinterpret_cast<VkImage *>(&image), &allocation, nullptr) == VK_SUCCESS;
     }
 
+    /**
+     * @brief Allocates a Vulkan image under the memory budget policy of the device, if any.
+     * @see memory_budget_policy
+     */
+    AGRB_EXPORT bool create_image(const vk::ImageCreateInfo &image_info, vk::Image &image, VmaAllocation &allocation,
+                                  device &device, VmaAllocationCreateInfo alloc_info);
+
     /**
      * @brief Clamp a 2D rectangle to fit within a given 2D extent.
      *
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <acul/memory/alloc.hpp>
+#include <atomic>
+
+namespace agrb
+{
+    /**
+     * @brief Unbounded lock-free multi-producer single-consumer queue.
+     *
+     * Producers link their node with a single atomic exchange, the consumer walks the list without any atomic
+     * read-modify-write. The last dequeued node serves as the sentinel, so T must be default constructible.
+     * push() may be called from any thread, pop() and empty() only from the consumer thread.
+     */
+    template <typename T>
+    class mpsc_queue
+    {
+    public:
+        mpsc_queue() : _head(&_stub), _tail(&_stub) {}
+
+        mpsc_queue(const mpsc_queue &) = delete;
+        mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+        ~mpsc_queue()
+        {
+            T value;
+            while (pop(value));
+            if (_tail != &_stub) acul::release(_tail);
+        }
+
+        void push(T &&value)
+        {
+            node *n = acul::alloc<node>();
+            n->value = std::move(value);
+            node *prev = _head.exchange(n, std::memory_order_acq_rel);
+            prev->next.store(n, std::memory_order_release);
+        }
+
+        /// @brief Dequeue the oldest element.
+        /// @return False if the queue is empty or a producer has not finished linking its node yet
+        bool pop(T &value)
+        {
+            node *tail = _tail;
+            node *next = tail->next.load(std::memory_order_acquire);
+            if (!next) return false;
+            value = std::move(next->value);
+            _tail = next;
+            if (tail != &_stub) acul::release(tail);
+            return true;
+        }
+
+        bool empty() const { return _tail->next.load(std::memory_order_acquire) == nullptr; }
+
+    private:
+        struct node
+        {
+            std::atomic<node *> next{nullptr};
+            T value;
+        };
+
+        std::atomic<node *> _head;
+        node *_tail;
+        node _stub;
+    };
+} // namespace agrb
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <future>
+#include "buffer.hpp"
+
+namespace agrb
+{
+    /// @brief Receives the submission result and the copied bytes. data is only valid during the call
+    /// and is nullptr if the submission failed
+    using readback_callback = acul::unique_function<void(vk::Result, const void *data, vk::DeviceSize size)>;
+
+    /// @brief Owned copy of the read back bytes, delivered through std::future
+    struct readback_result
+    {
+        vk::Result result = vk::Result::eNotReady;
+        acul::vector<u8> data;
+    };
+
+    struct readback_image_info
+    {
+        vk::Image image;
+        /// Layout of the image while the copy executes, eTransferSrcOptimal or eGeneral
+        vk::ImageLayout layout = vk::ImageLayout::eTransferSrcOptimal;
+        vk::Extent3D extent;
+        vk::Offset3D offset{0, 0, 0};
+        /// Size of one texel of the image format in bytes
+        u32 texel_size = 4;
+        u32 mip_level = 0;
+        u32 base_layer = 0;
+        u32 layer_count = 1;
+        vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+
+        readback_image_info &set_image(vk::Image value, vk::ImageLayout image_layout)
+        {
+            image = value;
+            layout = image_layout;
+            return *this;
+        }
+
+        readback_image_info &set_region(vk::Extent3D region_extent, vk::Offset3D region_offset = {0, 0, 0})
+        {
+            extent = region_extent;
+            offset = region_offset;
+            return *this;
+        }
+
+        readback_image_info &set_texel_size(u32 value)
+        {
+            texel_size = value;
+            return *this;
+        }
+
+        readback_image_info &set_layers(u32 base, u32 count)
+        {
+            base_layer = base;
+            layer_count = count;
+            return *this;
+        }
+
+        vk::DeviceSize size() const
+        {
+            return vk::DeviceSize(extent.width) * extent.height * extent.depth * layer_count * texel_size;
+        }
+    };
+
+    /**
+     * @brief Asynchronous GPU to host copies of buffers and images.
+     *
+     * read_buffer() and read_image() record a copy into a host-visible, preferably host-cached buffer on
+     * the given execution context. The copies are bound to their submission either by submit(), which submits
+     * a single_time_exec asynchronously, or by submitted() for command buffers submitted by their owner,
+     * e.g. the frame command buffer with frame_slot::submitted. collect() delivers the data of every completed
+     * copy, invalidating non-coherent memory first. Destination buffers are recycled between readbacks.
+     *
+     * Copies bound to an invalid point (devices without timeline semaphores) are only delivered by flush().
+     * The queue is not thread-safe; it is meant to be owned by the thread that records the copies.
+     */
+    class readback_queue
+    {
+    public:
+        /// @param max_cached_buffers Number of destination buffers kept for reuse once their data is delivered
+        explicit readback_queue(device &device, u32 max_cached_buffers = 4)
+            : _device(device), _max_cached_buffers(max_cached_buffers)
+        {
+        }
+
+        readback_queue(const readback_queue &) = delete;
+        readback_queue &operator=(const readback_queue &) = delete;
+
+        AGRB_EXPORT ~readback_queue();
+
+        /// @brief Record the copy of a buffer range
+        /// @return False if the destination buffer could not be allocated
+        AGRB_EXPORT bool read_buffer(single_time_exec &exec, vk::Buffer src, vk::DeviceSize size,
+                                     vk::DeviceSize offset, readback_callback &&callback);
+
+        /// @brief Record the copy of a buffer range, delivering the bytes through a future
+        std::future<readback_result> read_buffer(single_time_exec &exec, vk::Buffer src, vk::DeviceSize size,
+                                                 vk::DeviceSize offset = 0)
+        {
+            auto promise = acul::make_shared<std::promise<readback_result>>();
+            auto future = promise->get_future();
+            if (!read_buffer(exec, src, size, offset, make_promise_callback(promise)))
+                promise->set_value({vk::Result::eErrorOutOfDeviceMemory, {}});
+            return future;
+        }
+
+        /// @brief Record the copy of an image region. Texels are tightly packed, layer after layer
+        /// @return False if the destination buffer could not be allocated
+        AGRB_EXPORT bool read_image(single_time_exec &exec, const readback_image_info &info,
+                                    readback_callback &&callback);
+
+        /// @brief Record the copy of an image region, delivering the bytes through a future
+        std::future<readback_result> read_image(single_time_exec &exec, const readback_image_info &info)
+        {
+            auto promise = acul::make_shared<std::promise<readback_result>>();
+            auto future = promise->get_future();
+            if (!read_image(exec, info, make_promise_callback(promise)))
+                promise->set_value({vk::Result::eErrorOutOfDeviceMemory, {}});
+            return future;
+        }
+
+        /// @brief Submit the execution context asynchronously and bind the copies recorded on it
+        AGRB_EXPORT exec_ticket submit(single_time_exec &exec);
+
+        /// @brief Bind the copies recorded on a command buffer submitted by its owner
+        /// @param point Point signaled by the submission of the command buffer
+        AGRB_EXPORT void submitted(vk::CommandBuffer command_buffer, const timeline_point &point);
+
+        /// @brief Deliver the data of every completed copy
+        /// @return Number of delivered readbacks
+        AGRB_EXPORT size_t collect();
+
+        /// @brief Wait for every bound copy and deliver its data.
+        /// Unbound copies are dropped with eNotReady; their command buffers must not be submitted afterwards
+        AGRB_EXPORT void flush();
+
+        /// @brief Number of pending readbacks
+        size_t size() const { return _pending.size(); }
+
+    private:
+        struct pending_readback
+        {
+            vk::CommandBuffer command_buffer;
+            bool bound = false;
+            exec_ticket ticket;
+            timeline_point point;
+            buffer dst;
+            vk::DeviceSize size;
+            readback_callback callback;
+        };
+
+        device &_device;
+        u32 _max_cached_buffers;
+        acul::vector<pending_readback> _pending;
+        acul::vector<buffer> _cache;
+
+        static readback_callback make_promise_callback(const acul::shared_ptr<std::promise<readback_result>> &promise)
+        {
+            return [promise](vk::Result result, const void *data, vk::DeviceSize size) {
+                readback_result value{result, {}};
+                if (data)
+                {
+                    value.data.resize(size);
+                    memcpy(value.data.data(), data, size);
+                }
+                promise->set_value(std::move(value));
+            };
+        }
+
+        bool acquire_buffer(vk::DeviceSize size, buffer &dst);
+        bool push(single_time_exec &exec, buffer &dst, vk::DeviceSize size, readback_callback &&callback);
+        void deliver(pending_readback &readback, vk::Result result);
+    };
+} // namespace agrb
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <mutex>
+#include "buffer.hpp"
+
+namespace agrb
+{
+    struct staging_ring_stats
+    {
+        vk::DeviceSize capacity = 0;
+        /// Bytes between the oldest pending range and the write position, including alignment and wrap padding
+        vk::DeviceSize used = 0;
+        vk::DeviceSize peak_used = 0;
+        u64 allocations = 0;
+        /// Requests that did not fit and fell back to a dedicated staging buffer
+        u64 fallbacks = 0;
+        /// Allocations that had to wait for the GPU to release ring space
+        u64 stalls = 0;
+        u64 wraps = 0;
+
+        f32 utilization() const { return capacity ? static_cast<f32>(used) / static_cast<f32>(capacity) : 0.0f; }
+    };
+
+    /**
+     * @brief Persistently mapped host visible buffer that staging ranges are sub-allocated from.
+     *
+     * Ranges are handed out in submission order and wrap around at the end of the buffer. Each range is released
+     * once the submission that reads it completes: pass the ticket of that submission to retire(). When the ring
+     * is full, allocate() waits for the oldest retired submission and counts a stall. Requests larger than the
+     * ring, or that only fit behind ranges that have not been retired yet, fail so the caller can fall back
+     * to a dedicated staging buffer.
+     *
+     * To make the staging upload functions use the ring, create it after the allocator and store its address
+     * in device_runtime_data::staging. allocate(), retire() and stats() may be called from several threads and
+     * never block each other on the GPU. Observing a ticket completes it, which returns its command buffer and
+     * fence to the device pools, so every thread using the ring must be allowed to use those pools.
+     */
+    class staging_ring
+    {
+    public:
+        staging_ring() = default;
+
+        staging_ring(const staging_ring &) = delete;
+        staging_ring &operator=(const staging_ring &) = delete;
+
+        ~staging_ring() { destroy(); }
+
+        /// @brief Create the ring buffer and map it for the lifetime of the ring
+        /// @param capacity Size of the ring in bytes. Rounded up to max_alignment
+        AGRB_EXPORT bool create(device &device, vk::DeviceSize capacity);
+
+        /// @brief Wait for every pending range and destroy the buffer
+        AGRB_EXPORT void destroy();
+
+        bool valid() const { return _buffer.vk_buffer; }
+
+        /**
+         * @brief Sub-allocate a staging range
+         * @param size Size of the range in bytes
+         * @param out Receives the range. vk_buffer is the ring buffer, offset the start of the range and mapped
+         * points to its first byte. The range must not be destroyed, only retired
+         * @param alignment Power of two alignment of the range offset, at most max_alignment
+         * @return False if the range does not fit, the caller should create a dedicated staging buffer instead
+         */
+        AGRB_EXPORT bool allocate(vk::DeviceSize size, buffer &out, vk::DeviceSize alignment = default_alignment);
+
+        /// @brief Copy data into a range and flush it if the ring memory is not host coherent
+        AGRB_EXPORT void write(buffer &range, const void *data, vk::DeviceSize size);
+
+        /// @brief Release the range once the submission of the ticket completes.
+        /// An invalid ticket releases the range immediately
+        AGRB_EXPORT void retire(const buffer &range, const exec_ticket &ticket);
+
+        /// @brief Release every range whose submission has completed
+        /// @return Number of released ranges
+        size_t collect()
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            return reclaim();
+        }
+
+        AGRB_EXPORT staging_ring_stats stats() const;
+
+        /// Copies to images require offsets aligned to the texel size, 16 covers every uncompressed format but
+        /// the 96 bit ones.
+        static constexpr vk::DeviceSize default_alignment = 16;
+        static constexpr vk::DeviceSize max_alignment = 256;
+
+    private:
+        // Offsets only grow, the physical offset is offset % capacity. This keeps the full/empty checks trivial.
+        struct range_record
+        {
+            u64 end;
+            exec_ticket ticket;
+            bool retired = false;
+        };
+
+        device *_device = nullptr;
+        buffer _buffer;
+        bool _coherent = true;
+        u64 _head = 0;
+        u64 _tail = 0;
+        acul::vector<range_record> _ranges;
+        staging_ring_stats _stats;
+        mutable std::mutex _lock;
+
+        size_t reclaim();
+    };
+} // namespace agrb
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "buffer.hpp"
+
+namespace agrb
+{
+    /// @brief Source of a streamed upload. read() fills dst with size bytes starting at offset
+    struct stream_source
+    {
+        vk::DeviceSize size = 0;
+        acul::unique_function<bool(void *dst, vk::DeviceSize offset, vk::DeviceSize size)> read;
+    };
+
+    /// @brief Stream from a memory-mapped region, e.g. the payload of a mapped UMBF file.
+    /// Pages of the region are only touched chunk by chunk, while they are copied into staging.
+    inline stream_source make_mapped_stream_source(const void *data, vk::DeviceSize size)
+    {
+        stream_source source;
+        source.size = size;
+        source.read = [data](void *dst, vk::DeviceSize offset, vk::DeviceSize size) {
+            memcpy(dst, static_cast<const char *>(data) + offset, size);
+            return true;
+        };
+        return source;
+    }
+
+    struct stream_upload_info
+    {
+        stream_source source;
+        /// Bytes copied into staging and transferred per submission. Keep it a multiple of the texel size
+        /// when on_copy_chunk writes an image
+        vk::DeviceSize chunk_size = 4u << 20;
+        /// Number of chunks in flight. Host staging memory is bounded by read_ahead * chunk_size
+        u32 read_ahead = 3;
+
+        /// Records the copy of one chunk: staging holds source bytes [offset, offset + size)
+        acul::unique_function<void(single_time_exec &, buffer &staging, vk::DeviceSize offset, vk::DeviceSize size)>
+            on_copy_chunk;
+        /// Runs on the graphics queue once every chunk has been copied, e.g. layout transitions
+        acul::unique_function<void(single_time_exec &)> on_upload;
+        /// Same as gpu_upload_info::on_ownership_transfer: chunks are copied on the dedicated transfer queue
+        /// when it is set and the device has one
+        acul::unique_function<void(single_time_exec &, const queue_ownership &)> on_ownership_transfer;
+
+        stream_upload_info &set_source(stream_source &&value)
+        {
+            source = std::move(value);
+            return *this;
+        }
+
+        stream_upload_info &set_chunk_size(vk::DeviceSize value)
+        {
+            chunk_size = value;
+            return *this;
+        }
+
+        stream_upload_info &set_read_ahead(u32 value)
+        {
+            read_ahead = value;
+            return *this;
+        }
+    };
+
+    /// @brief Chunk copy callback writing the stream into a buffer
+    inline acul::unique_function<void(single_time_exec &, buffer &, vk::DeviceSize, vk::DeviceSize)>
+    make_stream_buffer_callback(buffer &dst_buffer, vk::DeviceSize dst_offset = 0)
+    {
+        return [&dst_buffer, dst_offset](single_time_exec &exec, buffer &staging, vk::DeviceSize offset,
+                                         vk::DeviceSize size) {
+            vk::BufferCopy region(staging.offset, dst_buffer.offset + dst_offset + offset, size);
+            exec.command_buffer.copyBuffer(staging.vk_buffer, dst_buffer.vk_buffer, 1, &region, exec.loader);
+        };
+    }
+
+    /**
+     * Uploads a large payload through a fixed set of staging buffers without loading it into host memory first.
+     * The payload is read chunk by chunk; while the GPU transfers one chunk, the next ones are read into the
+     * other staging buffers. A staging buffer is refilled only after the transfer reading it has completed.
+     * Blocks until the whole payload has been uploaded.
+     * @param[in] upload_info Stream description.
+     * @param[in] device The device to use for the upload.
+     * @return True if the upload was successful, false otherwise.
+     */
+    AGRB_EXPORT bool stream_to_gpu(stream_upload_info &upload_info, device &device);
+} // namespace agrb
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "buffer.hpp"
+
+namespace agrb
+{
+    /**
+     * @brief Collects many GPU uploads and records them into a single command buffer.
+     *
+     * Payloads are copied into staging memory when they are added, so the source data may be released right after
+     * add() returns. Copies recorded by on_copy_staging are emitted before any on_upload callback, which lets
+     * layout transitions and mipmap generation of all resources follow the copies in one submission.
+     */
+    class transfer_batch
+    {
+    public:
+        explicit transfer_batch(device &device) : _device(device) {}
+
+        transfer_batch(const transfer_batch &) = delete;
+        transfer_batch &operator=(const transfer_batch &) = delete;
+
+        ~transfer_batch() { release_staging(_staging, _device); }
+
+        /**
+         * Adds an upload to the batch.
+         * Host visible allocations are written immediately and only their on_upload callback is deferred.
+         * An external upload_info.staging buffer is written by on_staging_request() right away, so every pending
+         * upload needs its own staging range: a range overlapping the one of a pending upload is rejected.
+         * @param[in] upload_info Information about the upload.
+         * @return True if the payload was accepted, false otherwise.
+         */
+        AGRB_EXPORT bool add(gpu_upload_info &&upload_info);
+
+        /**
+         * Records all pending uploads into one command buffer and submits it once.
+         * Uploads that provide on_ownership_transfer are copied on the dedicated transfer queue first, if any.
+         * Staging buffers are released when the returned ticket completes.
+         * @return Ticket reporting completion of the whole batch. Invalid if the batch was empty.
+         */
+        AGRB_EXPORT exec_ticket submit();
+
+        /**
+         * Records all pending uploads into an existing execution context, e.g. the command buffer of the next frame.
+         * @param[in] exec Destination execution context.
+         * @return Staging buffers that must be kept alive until the command buffer has been executed.
+         * Release them with release_staging().
+         */
+        acul::vector<buffer> record(single_time_exec &exec) { return record(exec, nullptr); }
+
+        /// @brief Destroy staging buffers returned by record()
+        static void release_staging(acul::vector<buffer> &staging, device &device)
+        {
+            for (auto &buffer : staging)
+                if (buffer.vk_buffer) destroy_buffer(buffer, device);
+            staging.clear();
+        }
+
+        /// @brief Number of uploads waiting to be recorded
+        size_t size() const { return _uploads.size(); }
+
+        bool empty() const { return _uploads.empty(); }
+
+    private:
+        static constexpr size_t external_staging = SIZE_MAX;
+
+        struct upload_record
+        {
+            gpu_upload_info info;
+            size_t staging_id = external_staging;
+            bool host_visible = false;
+            bool transferred = false;
+        };
+
+        device &_device;
+        acul::vector<upload_record> _uploads;
+        acul::vector<buffer> _staging;
+
+        buffer &staging_of(upload_record &upload);
+        bool overlaps_pending_staging(const buffer &staging, vk::DeviceSize size) const;
+        AGRB_EXPORT acul::vector<buffer> record(single_time_exec &exec, const queue_ownership *ownership);
+    };
+} // namespace agrb
@@ -2,6 +2,7 @@
 
 #include <acul/enum.hpp>
 #include <iterator>
+#include "retire.hpp"
 #include "utils/buffer.hpp"
 
 namespace agrb
@@ -85,11 +86,13 @@ namespace agrb
         vector(const vector &) = delete;
         vector &operator=(const vector &) = delete;
 
-        vector(vector &&other) : _device(other._device), _data(other._data), _size(other._size)
+        vector(vector &&other)
+            : _device(other._device), _retire(other._retire), _data(other._data), _size(other._size)
         {
             if (this != &other)
             {
                 other._device = nullptr;
+                other._retire = nullptr;
                 other._size = 0;
                 other._data = {};
             }
@@ -148,10 +151,14 @@ namespace agrb
 
         void destroy()
         {
-            if (_data.vk_buffer) destroy_buffer(_data, *_device);
+            if (_data.vk_buffer) release_buffer(_data);
             _size = 0;
         }
 
+        /// @brief Retire replaced and destroyed buffers instead of destroying them immediately.
+        /// Buffers are retired against the last graphics submission, so in-flight frames may keep using them.
+        void set_retire_queue(retire_queue *queue) { _retire = queue; }
+
         bool empty() const { return _size == 0; }
 
         reference operator[](size_type index)
@@ -197,6 +204,10 @@ namespace agrb
         buffer &data() { return _data; }
         const buffer &data() const { return _data; }
 
+        /// @brief GPU address of the elements when the buffer usage includes eShaderDeviceAddress.
+        /// The address changes whenever an operation reports VectorResultBits::buffer_reallocated
+        vk::DeviceAddress device_address() const { return _data.device_address(); }
+
         reference front() { return (*this)[0]; }
         const_reference front() const { return (*this)[0]; }
 
@@ -362,6 +373,7 @@ namespace agrb
     private:
         device *_device = nullptr;
         device_runtime_data *_rd = nullptr;
+        retire_queue *_retire = nullptr;
         managed_buffer _data;
         size_type _size = 0;
 
@@ -392,6 +404,14 @@ namespace agrb
             acul::release(tmp);
         }
 
+        void release_buffer(buffer &buffer)
+        {
+            if (_retire)
+                retire_buffer(buffer, *_device, *_retire, _retire->current_point());
+            else
+                destroy_buffer(buffer, *_device);
+        }
+
         size_type get_required_mem(size_type n) const { return n * _data.alignment_size; }
 
         bool reallocate(bool adjust_capacity = true)
@@ -401,6 +421,8 @@ namespace agrb
                 _data.instance_count = acul::get_growth_size(_data.instance_count, _data.instance_count + 1);
             managed_buffer new_buffer = _data;
             new_buffer.instance_count = static_cast<u32>(_data.instance_count);
+            // The new allocation may land in memory of another coherency, so it gets a tracker of its own.
+            new_buffer.dirty_ranges = {};
             construct_buffer(new_buffer, sizeof(value_type));
 
             auto create_info =
@@ -411,9 +433,10 @@ namespace agrb
                 destroy_buffer(new_buffer, *_device);
                 return false;
             }
+            if (_data.dirty_ranges) track_dirty_ranges(new_buffer, *_device);
             if (_data.mapped && _size > 0)
                 write_to_buffer(new_buffer, _data.mapped, get_required_mem(_size));
-            destroy_buffer(_data, *_device);
+            release_buffer(_data);
             _data = new_buffer;
             return true;
         }
@@ -0,0 +1,182 @@
+#include <agrb/aliasing.hpp>
+
+namespace agrb
+{
+    void aliasing_allocator::declare(fb_image &image, const vk::ImageCreateInfo &image_info, alias_lifetime lifetime)
+    {
+        declared_resource resource{};
+        resource.owner = &image;
+        resource.is_image = true;
+        resource.image_info = image_info;
+        resource.lifetime = lifetime;
+        _resources.push_back(resource);
+    }
+
+    void aliasing_allocator::declare(buffer &buffer, vk::DeviceSize size, vk::BufferUsageFlags usage,
+                                     alias_lifetime lifetime)
+    {
+        declared_resource resource{};
+        resource.owner = &buffer;
+        resource.is_image = false;
+        resource.buffer_info.setSize(size).setUsage(usage).setSharingMode(vk::SharingMode::eExclusive);
+        resource.lifetime = lifetime;
+        _resources.push_back(resource);
+    }
+
+    void aliasing_allocator::place(u32 index)
+    {
+        auto &resource = _resources[index];
+        const auto &req = resource.requirements;
+        // Buffers and optimal images may share a block, so every offset respects the buffer-image granularity.
+        vk::DeviceSize alignment =
+            std::max(req.alignment, _device.rd->properties2.properties.limits.bufferImageGranularity);
+        auto align = [alignment](vk::DeviceSize offset) { return (offset + alignment - 1) / alignment * alignment; };
+
+        for (u32 b = 0; b < _blocks.size(); ++b)
+        {
+            auto &block = _blocks[b];
+            if (!(block.memory_type_bits & req.memoryTypeBits)) continue;
+
+            // The lowest free offset is either the block start or the end of a resource alive at the same time.
+            acul::vector<vk::DeviceSize> candidates{0};
+            for (u32 other : block.resources)
+                if (_resources[other].lifetime.overlaps(resource.lifetime))
+                    candidates.push_back(align(_resources[other].offset + _resources[other].requirements.size));
+            std::sort(candidates.begin(), candidates.end());
+            for (vk::DeviceSize offset : candidates)
+            {
+                bool is_free = std::none_of(block.resources.begin(), block.resources.end(), [&](u32 other) {
+                    const auto &placed = _resources[other];
+                    if (!placed.lifetime.overlaps(resource.lifetime)) return false;
+                    return offset < placed.offset + placed.requirements.size && placed.offset < offset + req.size;
+                });
+                if (!is_free) continue;
+                resource.block = b;
+                resource.offset = offset;
+                block.memory_type_bits &= req.memoryTypeBits;
+                block.size = std::max(block.size, offset + req.size);
+                block.alignment = std::max(block.alignment, alignment);
+                block.resources.push_back(index);
+                return;
+            }
+        }
+
+        memory_block block;
+        block.memory_type_bits = req.memoryTypeBits;
+        block.size = req.size;
+        block.alignment = alignment;
+        block.resources.push_back(index);
+        resource.block = static_cast<u32>(_blocks.size());
+        resource.offset = 0;
+        _blocks.push_back(std::move(block));
+    }
+
+    bool aliasing_allocator::build(const VmaAllocationCreateInfo &alloc_info)
+    {
+        auto &vk_device = _device.vk_device;
+        auto &loader = _device.loader;
+        assert(_blocks.empty() && "release() the previous build first");
+        _stats = {};
+        for (auto &resource : _resources)
+        {
+            if (resource.is_image)
+            {
+                resource.image = vk_device.createImage(resource.image_info, nullptr, loader);
+                resource.requirements = vk_device.getImageMemoryRequirements(resource.image, loader);
+            }
+            else
+            {
+                if ((resource.buffer_info.usage & vk::BufferUsageFlagBits::eShaderDeviceAddress) &&
+                    !_device.rd->features.buffer_device_address)
+                {
+                    discard();
+                    return false;
+                }
+                resource.vk_buffer = vk_device.createBuffer(resource.buffer_info, nullptr, loader);
+                resource.requirements = vk_device.getBufferMemoryRequirements(resource.vk_buffer, loader);
+            }
+            _stats.requested_bytes += resource.requirements.size;
+        }
+
+        // Largest first keeps the blocks tight: smaller resources fill the gaps left between the large ones.
+        acul::vector<u32> order(_resources.size());
+        for (u32 i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](u32 a, u32 b) {
+            return _resources[a].requirements.size > _resources[b].requirements.size;
+        });
+        for (u32 index : order) place(index);
+
+        for (auto &block : _blocks)
+        {
+            VkMemoryRequirements requirements{block.size, block.alignment, block.memory_type_bits};
+            if (vmaAllocateMemory(_device.allocator, &requirements, &alloc_info, &block.allocation, nullptr) !=
+                VK_SUCCESS)
+            {
+                discard();
+                return false;
+            }
+            _stats.allocated_bytes += block.size;
+        }
+
+        for (auto &resource : _resources)
+        {
+            auto allocation = _blocks[resource.block].allocation;
+            VkResult res = resource.is_image
+                               ? vmaBindImageMemory2(_device.allocator, allocation, resource.offset, resource.image,
+                                                     nullptr)
+                               : vmaBindBufferMemory2(_device.allocator, allocation, resource.offset,
+                                                      resource.vk_buffer, nullptr);
+            if (res != VK_SUCCESS)
+            {
+                discard();
+                return false;
+            }
+        }
+
+        for (auto &resource : _resources)
+        {
+            if (resource.is_image)
+            {
+                auto &image = *static_cast<fb_image *>(resource.owner);
+                image.image = resource.image;
+                image.memory = VK_NULL_HANDLE;
+                continue;
+            }
+            auto &owner = *static_cast<buffer *>(resource.owner);
+            owner = {};
+            owner.instance_count = 1;
+            owner.vk_buffer = resource.vk_buffer;
+            owner.buffer_size = resource.buffer_info.size;
+            owner.alignment_size = resource.buffer_info.size;
+            if (resource.buffer_info.usage & vk::BufferUsageFlagBits::eShaderDeviceAddress)
+                owner.address = get_buffer_device_address(resource.vk_buffer, _device);
+        }
+        _stats.resources = static_cast<u32>(_resources.size());
+        _stats.blocks = static_cast<u32>(_blocks.size());
+        return true;
+    }
+
+    // Undo a failed build: the handles were not handed out yet
+    void aliasing_allocator::discard()
+    {
+        for (auto &resource : _resources)
+        {
+            if (resource.image) _device.vk_device.destroyImage(resource.image, nullptr, _device.loader);
+            if (resource.vk_buffer) _device.vk_device.destroyBuffer(resource.vk_buffer, nullptr, _device.loader);
+            resource.image = nullptr;
+            resource.vk_buffer = nullptr;
+        }
+        for (auto &block : _blocks)
+            if (block.allocation) vmaFreeMemory(_device.allocator, block.allocation);
+        _blocks.clear();
+        _stats = {};
+    }
+
+    void aliasing_allocator::release()
+    {
+        for (auto &block : _blocks) vmaFreeMemory(_device.allocator, block.allocation);
+        _blocks.clear();
+        _resources.clear();
+        _stats = {};
+    }
+} // namespace agrb
@@ -0,0 +1,144 @@
+#include <agrb/buffer_arena.hpp>
+
+namespace agrb
+{
+    void buffer_arena::create(device &device, const buffer_arena_create_info &create_info)
+    {
+        assert(!_device && create_info.block_size > 0);
+        _device = &device;
+        _create_info = create_info;
+
+        // Offsets have to satisfy the strictest descriptor type the ranges can be bound as.
+        auto &limits = device.rd->properties2.properties.limits;
+        auto usage = create_info.usage;
+        _alignment = 4;
+        if (usage & vk::BufferUsageFlagBits::eUniformBuffer)
+            _alignment = std::max(_alignment, limits.minUniformBufferOffsetAlignment);
+        if (usage & vk::BufferUsageFlagBits::eStorageBuffer)
+            _alignment = std::max(_alignment, limits.minStorageBufferOffsetAlignment);
+        if (usage & (vk::BufferUsageFlagBits::eUniformTexelBuffer | vk::BufferUsageFlagBits::eStorageTexelBuffer))
+            _alignment = std::max(_alignment, limits.minTexelBufferOffsetAlignment);
+        // Flushes of neighbouring ranges must not overlap on non-coherent memory.
+        if (create_info.mapped) _alignment = std::max(_alignment, limits.nonCoherentAtomSize);
+    }
+
+    buffer_arena::block *buffer_arena::create_block(vk::DeviceSize size)
+    {
+        auto *new_block = acul::alloc<block>();
+        new_block->data.instance_count = 1;
+        construct_buffer(new_block->data, size);
+        if (!allocate_buffer(new_block->data, _create_info.alloc_info, _create_info.usage, *_device))
+        {
+            acul::release(new_block);
+            return nullptr;
+        }
+        if (_create_info.mapped && !map_buffer(new_block->data, *_device))
+        {
+            destroy_buffer(new_block->data, *_device);
+            acul::release(new_block);
+            return nullptr;
+        }
+
+        VmaVirtualBlockCreateInfo virtual_info{};
+        virtual_info.size = size;
+        if (vmaCreateVirtualBlock(&virtual_info, &new_block->virtual_block) != VK_SUCCESS)
+        {
+            destroy_buffer(new_block->data, *_device);
+            acul::release(new_block);
+            return nullptr;
+        }
+        _blocks.push_back(new_block);
+        return new_block;
+    }
+
+    void buffer_arena::destroy_block(block *block)
+    {
+        vmaClearVirtualBlock(block->virtual_block);
+        vmaDestroyVirtualBlock(block->virtual_block);
+        destroy_buffer(block->data, *_device);
+        acul::release(block);
+    }
+
+    void buffer_arena::destroy()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        for (auto *block : _blocks) destroy_block(block);
+        _blocks.clear();
+        _device = nullptr;
+    }
+
+    bool buffer_arena::allocate(vk::DeviceSize size, buffer &out, vk::DeviceSize alignment)
+    {
+        assert(_device && size > 0);
+        VmaVirtualAllocationCreateInfo range_info{};
+        range_info.size = size;
+        range_info.alignment = std::max(alignment, _alignment);
+
+        std::lock_guard<std::mutex> lock(_lock);
+        VmaVirtualAllocation range = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        block *owner = nullptr;
+        for (auto *block : _blocks)
+        {
+            if (vmaVirtualAllocate(block->virtual_block, &range_info, &range, &offset) != VK_SUCCESS) continue;
+            owner = block;
+            break;
+        }
+        if (!owner)
+        {
+            owner = create_block(std::max(size, _create_info.block_size));
+            if (!owner || vmaVirtualAllocate(owner->virtual_block, &range_info, &range, &offset) != VK_SUCCESS)
+                return false;
+        }
+
+        owner->ranges[offset] = range;
+        owner->used += size;
+        out = {};
+        out.instance_count = 1;
+        out.vk_buffer = owner->data.vk_buffer;
+        out.allocation = owner->data.allocation;
+        out.address = owner->data.address;
+        out.offset = offset;
+        out.buffer_size = size;
+        out.alignment_size = size;
+        if (owner->data.mapped) out.mapped = static_cast<char *>(owner->data.mapped) + offset;
+        return true;
+    }
+
+    void buffer_arena::release(buffer &range)
+    {
+        if (!range.vk_buffer) return;
+        std::lock_guard<std::mutex> lock(_lock);
+        auto it = std::find_if(_blocks.begin(), _blocks.end(),
+                               [&range](const block *block) { return block->data.vk_buffer == range.vk_buffer; });
+        assert(it != _blocks.end() && "The range does not belong to the arena");
+        block *owner = *it;
+        auto entry = owner->ranges.find(range.offset);
+        assert(entry != owner->ranges.end());
+        vmaVirtualFree(owner->virtual_block, entry->second);
+        owner->ranges.erase(entry);
+        owner->used -= range.buffer_size;
+        range = {};
+
+        // Keep the first block around so that a steady allocate/release pattern never recreates buffers.
+        if (owner->ranges.empty() && it != _blocks.begin())
+        {
+            destroy_block(owner);
+            _blocks.erase(it);
+        }
+    }
+
+    buffer_arena_stats buffer_arena::stats() const
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        buffer_arena_stats stats;
+        stats.blocks = _blocks.size();
+        for (auto *block : _blocks)
+        {
+            stats.block_bytes += block->data.buffer_size;
+            stats.used_bytes += block->used;
+            stats.allocations += block->ranges.size();
+        }
+        return stats;
+    }
+} // namespace agrb
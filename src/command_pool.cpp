@@ -0,0 +1,146 @@
+#include <agrb/command_pool.hpp>
+#include <exception>
+
+namespace agrb
+{
+    void command_pool_registry::create(device &device, const queue_family_info &queue, u32 workers, u32 frames,
+                                       size_t primary, size_t secondary)
+    {
+        assert(!valid() && workers > 0 && frames > 0);
+        _device = &device;
+        _workers = workers;
+        _frames = frames;
+        _pools.resize(workers * frames);
+
+        vk::CommandPoolCreateInfo create_info;
+        create_info.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+            .setQueueFamilyIndex(queue.family_id.value());
+        for (auto &pool : _pools)
+        {
+            pool.vk_pool = device.vk_device.createCommandPool(create_info, nullptr, device.loader);
+
+            pool.primary.allocator.device = &device.vk_device;
+            pool.primary.allocator.loader = &device.loader;
+            pool.primary.allocator.command_pool = &pool.vk_pool;
+            pool.primary.allocate(primary);
+
+            pool.secondary.allocator.device = &device.vk_device;
+            pool.secondary.allocator.loader = &device.loader;
+            pool.secondary.allocator.command_pool = &pool.vk_pool;
+            pool.secondary.allocate(secondary);
+        }
+    }
+
+    void command_pool_registry::destroy()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto &thread : _threads) thread.join();
+        _threads.clear();
+        _stop = false;
+
+        for (auto &pool : _pools) _device->vk_device.destroyCommandPool(pool.vk_pool, nullptr, _device->loader);
+        _pools.clear();
+        _workers = 0;
+        _frames = 0;
+    }
+
+    void command_pool_registry::reset(u32 frame)
+    {
+        assert(frame < _frames);
+        for (u32 worker = 0; worker < _workers; ++worker)
+        {
+            auto &pool = acquire(worker, frame);
+            _device->vk_device.resetCommandPool(pool.vk_pool, {}, _device->loader);
+            pool.primary.reset();
+            pool.secondary.reset();
+        }
+    }
+
+    void command_pool_registry::worker_loop(u32 worker)
+    {
+        u64 generation = 0;
+        for (;;)
+        {
+            acul::unique_function<void(u32)> *job;
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+                _wake.wait(lock, [&] { return _stop || _generation != generation; });
+                if (_stop) return;
+                generation = _generation;
+                if (worker >= _job_workers) continue;
+                job = _job;
+            }
+            (*job)(worker);
+            std::lock_guard<std::mutex> lock(_lock);
+            if (--_pending == 0) _done.notify_one();
+        }
+    }
+
+    void command_pool_registry::run_workers(u32 count, acul::unique_function<void(u32)> &job)
+    {
+        assert(count > 0 && count <= _workers);
+        if (count > 1)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if (_threads.empty())
+            {
+                _threads.reserve(_workers - 1);
+                for (u32 worker = 1; worker < _workers; ++worker)
+                    _threads.emplace_back(&command_pool_registry::worker_loop, this, worker);
+            }
+            _job = &job;
+            _job_workers = count;
+            _pending = count - 1;
+            ++_generation;
+            _wake.notify_all();
+        }
+        job(0);
+        if (count == 1) return;
+        std::unique_lock<std::mutex> lock(_lock);
+        _done.wait(lock, [this] { return _pending == 0; });
+        _job = nullptr;
+    }
+
+    void record_secondary_parallel(command_pool_registry &registry, u32 frame, vk::CommandBuffer primary,
+                                   const vk::CommandBufferInheritanceInfo &inheritance,
+                                   acul::vector<secondary_record_task> &tasks, vk::DispatchLoaderDynamic &loader)
+    {
+        if (tasks.empty()) return;
+        acul::vector<vk::CommandBuffer> buffers(tasks.size());
+        vk::CommandBufferUsageFlags usage = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        if (inheritance.renderPass) usage |= vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+        vk::CommandBufferBeginInfo begin_info(usage, &inheritance);
+
+        const u32 workers = static_cast<u32>(std::min<size_t>(registry.workers(), tasks.size()));
+        acul::vector<std::exception_ptr> errors(workers);
+        acul::unique_function<void(u32)> record_range = [&](u32 worker) {
+            try
+            {
+                size_t first = tasks.size() * worker / workers;
+                size_t last = tasks.size() * (worker + 1) / workers;
+                auto &pool = registry.acquire(worker, frame);
+                pool.secondary.request(buffers.data() + first, last - first);
+                for (size_t i = first; i < last; ++i)
+                {
+                    buffers[i].begin(begin_info, loader);
+                    tasks[i](buffers[i]);
+                    buffers[i].end(loader);
+                }
+            }
+            catch (...)
+            {
+                errors[worker] = std::current_exception();
+            }
+        };
+
+        registry.run_workers(workers, record_range);
+        for (auto &error : errors)
+            if (error) std::rethrow_exception(error);
+
+        primary.executeCommands(static_cast<u32>(buffers.size()), buffers.data(), loader);
+    }
+} // namespace agrb
@@ -0,0 +1,265 @@
+#include <agrb/defrag.hpp>
+
+namespace agrb
+{
+    static vk::ImageAspectFlags get_format_aspect(vk::Format format)
+    {
+        switch (format)
+        {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eX8D24UnormPack32:
+            case vk::Format::eD32Sfloat:
+                return vk::ImageAspectFlagBits::eDepth;
+            case vk::Format::eS8Uint:
+                return vk::ImageAspectFlagBits::eStencil;
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            default:
+                return vk::ImageAspectFlagBits::eColor;
+        }
+    }
+
+    // Copy every mip level and layer of an image into a freshly created one and leave it in the given layout
+    static void record_image_move(single_time_exec &exec, vk::Image src, vk::Image dst,
+                                  const vk::ImageCreateInfo &info, vk::ImageLayout layout)
+    {
+        auto aspect = get_format_aspect(info.format);
+        vk::ImageSubresourceRange range{aspect, 0, info.mipLevels, 0, info.arrayLayers};
+        vk::ImageMemoryBarrier barriers[2];
+        barriers[0]
+            .setOldLayout(layout)
+            .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+            .setSrcAccessMask(vk::AccessFlagBits::eMemoryWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(src)
+            .setSubresourceRange(range);
+        barriers[1]
+            .setOldLayout(vk::ImageLayout::eUndefined)
+            .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(dst)
+            .setSubresourceRange(range);
+        exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                                            vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 2,
+                                            barriers, exec.loader);
+
+        acul::vector<vk::ImageCopy> regions(info.mipLevels);
+        for (u32 mip = 0; mip < info.mipLevels; ++mip)
+        {
+            vk::ImageSubresourceLayers layers{aspect, mip, 0, info.arrayLayers};
+            vk::Extent3D extent{std::max(1u, info.extent.width >> mip), std::max(1u, info.extent.height >> mip),
+                                std::max(1u, info.extent.depth >> mip)};
+            regions[mip] = vk::ImageCopy{layers, {0, 0, 0}, layers, {0, 0, 0}, extent};
+        }
+        exec.command_buffer.copyImage(src, vk::ImageLayout::eTransferSrcOptimal, dst,
+                                      vk::ImageLayout::eTransferDstOptimal, static_cast<u32>(regions.size()),
+                                      regions.data(), exec.loader);
+
+        // Images whose contents are discarded between frames stay in the transfer layout.
+        if (layout == vk::ImageLayout::eUndefined) return;
+        barriers[1]
+            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setNewLayout(layout)
+            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+        exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                            vk::PipelineStageFlagBits::eAllCommands, {}, 0, nullptr, 0, nullptr, 1,
+                                            &barriers[1], exec.loader);
+    }
+
+    void defragmenter::track(buffer &buffer, vk::BufferUsageFlags usage,
+                             acul::unique_function<void(agrb::buffer &)> &&on_moved)
+    {
+        assert(buffer.allocation);
+        auto &resource = _tracked[buffer.allocation];
+        resource.kind = resource_kind::buffer;
+        resource.owner = &buffer;
+        resource.buffer_info.setSize(buffer.buffer_size)
+            .setUsage(usage | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        resource.on_buffer_moved = std::move(on_moved);
+    }
+
+    void defragmenter::track(texture &texture, vk::ImageUsageFlags usage, vk::ImageViewType view_type,
+                             acul::unique_function<void(agrb::texture &)> &&on_moved)
+    {
+        assert(texture.allocation);
+        auto &resource = _tracked[texture.allocation];
+        resource.kind = resource_kind::texture;
+        resource.owner = &texture;
+        resource.view_type = view_type;
+        resource.layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        resource.image_info.setImageType(view_type == vk::ImageViewType::e3D ? vk::ImageType::e3D : vk::ImageType::e2D)
+            .setFormat(texture.format)
+            .setExtent(texture.image_extent)
+            .setMipLevels(texture.mip_levels)
+            .setArrayLayers(texture.array_layers)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setInitialLayout(vk::ImageLayout::eUndefined)
+            .setUsage(usage | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        if (view_type == vk::ImageViewType::eCube || view_type == vk::ImageViewType::eCubeArray)
+            resource.image_info.setFlags(vk::ImageCreateFlagBits::eCubeCompatible);
+        resource.on_texture_moved = std::move(on_moved);
+    }
+
+    void defragmenter::track(fb_image &image, const vk::ImageCreateInfo &image_info, vk::ImageLayout layout,
+                             acul::unique_function<void(fb_image &, vk::Image)> &&on_moved)
+    {
+        assert(image.memory && on_moved);
+        auto &resource = _tracked[image.memory];
+        resource.kind = resource_kind::fb_image;
+        resource.owner = &image;
+        resource.image_info = image_info;
+        resource.layout = layout;
+        resource.on_fb_image_moved = std::move(on_moved);
+    }
+
+    bool defragmenter::begin(const defrag_config &config)
+    {
+        if (running()) return true;
+        VmaDefragmentationInfo info{};
+        info.flags = config.flags;
+        info.maxBytesPerPass = config.bytes_per_pass;
+        info.maxAllocationsPerPass = config.allocations_per_pass;
+        return vmaBeginDefragmentation(_device.allocator, &info, &_context) == VK_SUCCESS;
+    }
+
+    bool defragmenter::move(VmaDefragmentationMove &move, single_time_exec &exec)
+    {
+        auto it = _tracked.find(move.srcAllocation);
+        if (it == _tracked.end()) return false;
+        auto &resource = it->second;
+        auto &vk_device = _device.vk_device;
+        if (resource.kind == resource_kind::buffer)
+        {
+            auto &owner = *static_cast<buffer *>(resource.owner);
+            if (owner.mapped) return false;
+            vk::Buffer new_buffer = vk_device.createBuffer(resource.buffer_info, nullptr, _device.loader);
+            if (vmaBindBufferMemory(_device.allocator, move.dstTmpAllocation, new_buffer) != VK_SUCCESS)
+            {
+                vk_device.destroyBuffer(new_buffer, nullptr, _device.loader);
+                return false;
+            }
+            vk::BufferCopy region(0, 0, resource.buffer_info.size);
+            exec.command_buffer.copyBuffer(owner.vk_buffer, new_buffer, 1, &region, exec.loader);
+            _moves.push_back({owner.vk_buffer, {}, {}});
+            owner.vk_buffer = new_buffer;
+            if (resource.buffer_info.usage & vk::BufferUsageFlagBits::eShaderDeviceAddress)
+                owner.address = get_buffer_device_address(new_buffer, _device);
+            if (resource.on_buffer_moved) resource.on_buffer_moved(owner);
+            return true;
+        }
+
+        vk::Image new_image = vk_device.createImage(resource.image_info, nullptr, _device.loader);
+        if (vmaBindImageMemory(_device.allocator, move.dstTmpAllocation, new_image) != VK_SUCCESS)
+        {
+            vk_device.destroyImage(new_image, nullptr, _device.loader);
+            return false;
+        }
+        if (resource.kind == resource_kind::texture)
+        {
+            auto &owner = *static_cast<texture *>(resource.owner);
+            record_image_move(exec, owner.image, new_image, resource.image_info, resource.layout);
+            vk::ImageViewCreateInfo view_info;
+            view_info.setImage(new_image)
+                .setViewType(resource.view_type)
+                .setFormat(owner.format)
+                .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, owner.mip_levels, 0, owner.array_layers});
+            _moves.push_back({{}, owner.image, owner.image_view});
+            owner.image = new_image;
+            if (owner.image_view) owner.image_view = vk_device.createImageView(view_info, nullptr, _device.loader);
+            if (resource.on_texture_moved) resource.on_texture_moved(owner);
+            return true;
+        }
+
+        auto &owner = *static_cast<fb_image *>(resource.owner);
+        record_image_move(exec, owner.image, new_image, resource.image_info, resource.layout);
+        _moves.push_back({{}, owner.image, {}});
+        vk::Image old_image = owner.image;
+        owner.image = new_image;
+        resource.on_fb_image_moved(owner, old_image);
+        return true;
+    }
+
+    bool defragmenter::record_pass(single_time_exec &exec)
+    {
+        if (!running() || _pass_open) return false;
+        VkResult res = vmaBeginDefragmentationPass(_device.allocator, _context, &_pass);
+        if (res != VK_INCOMPLETE)
+        {
+            // VK_SUCCESS means there is nothing left to move.
+            finish();
+            return false;
+        }
+        _pass_open = true;
+
+        vk::MemoryBarrier barrier;
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eMemoryWrite).setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+        exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                                            vk::PipelineStageFlagBits::eTransfer, {}, 1, &barrier, 0, nullptr, 0,
+                                            nullptr, exec.loader);
+        for (u32 i = 0; i < _pass.moveCount; ++i)
+            if (!move(_pass.pMoves[i], exec)) _pass.pMoves[i].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+        exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                            vk::PipelineStageFlagBits::eAllCommands, {}, 1, &barrier, 0, nullptr, 0,
+                                            nullptr, exec.loader);
+        ++_stats.passes;
+        return true;
+    }
+
+    void defragmenter::end_pass()
+    {
+        if (!_pass_open) return;
+        // The old resources are bound to the memory VMA releases when the pass ends.
+        auto &vk_device = _device.vk_device;
+        for (auto &move : _moves)
+        {
+            if (move.old_view) vk_device.destroyImageView(move.old_view, nullptr, _device.loader);
+            if (move.old_image) vk_device.destroyImage(move.old_image, nullptr, _device.loader);
+            if (move.old_buffer) vk_device.destroyBuffer(move.old_buffer, nullptr, _device.loader);
+        }
+        _moves.clear();
+        _pass_open = false;
+        if (vmaEndDefragmentationPass(_device.allocator, _context, &_pass) != VK_INCOMPLETE) finish();
+    }
+
+    void defragmenter::finish()
+    {
+        if (!running()) return;
+        VmaDefragmentationStats stats{};
+        vmaEndDefragmentation(_device.allocator, _context, &stats);
+        _context = VK_NULL_HANDLE;
+        _stats.moved_allocations += stats.allocationsMoved;
+        _stats.moved_bytes += stats.bytesMoved;
+        _stats.freed_bytes += stats.bytesFreed;
+    }
+
+    void defragmenter::run()
+    {
+        if (!begin()) return;
+        while (running())
+        {
+            single_time_exec exec{_device};
+            bool recorded = record_pass(exec);
+            exec.end();
+            if (!recorded) break;
+            end_pass();
+        }
+    }
+
+    void defragmenter::cancel()
+    {
+        end_pass();
+        finish();
+    }
+} // namespace agrb
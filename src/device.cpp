@@ -3,7 +3,8 @@
 #define DEVICE_QUEUE_GRAPHICS 0
 #define DEVICE_QUEUE_PRESENT  1
 #define DEVICE_QUEUE_COMPUTE  2
-#define DEVICE_QUEUE_COUNT    3
+#define DEVICE_QUEUE_TRANSFER 3
+#define DEVICE_QUEUE_COUNT    4
 
 namespace agrb
 {
@@ -82,6 +83,13 @@ namespace agrb
     void destroy_device(device &device)
     {
         if (!device.vk_device) return;
+        if (device.rd)
+        {
+            auto &queues = device.rd->queues;
+            queues.wait_timelines(device.vk_device, device.loader);
+            for (auto *queue : {&queues.graphics, &queues.compute, &queues.transfer})
+                queue->timeline.destroy(device.vk_device, device.loader);
+        }
         if (device.allocator) vmaDestroyAllocator(device.allocator);
         device.vk_device.destroy(nullptr, device.loader);
 #ifndef NDEBUG
@@ -108,6 +116,7 @@ namespace agrb
         create_logical_device();
         create_allocator();
         allocate_command_pools();
+        if (runtime_data.features.timeline_semaphores) runtime_data.queues.create_timelines(device, loader);
         auto &fence_pool = runtime_data.fence_pool;
         fence_pool.allocator.device = &device;
         fence_pool.allocator.loader = &loader;
@@ -224,6 +233,7 @@ namespace agrb
         auto &queues = runtime_data.queues;
         auto devices = instance.enumeratePhysicalDevices(loader);
         std::optional<u32> indices[DEVICE_QUEUE_COUNT];
+        std::optional<u32> selected_indices[DEVICE_QUEUE_COUNT];
         if (create_ctx->ph_selector)
         {
             auto *device = create_ctx->ph_selector->request(devices);
@@ -232,6 +242,7 @@ namespace agrb
                 if (validate_physical_device(*device, extensions, indices))
                 {
                     physical_device = *device;
+                    std::copy_n(indices, DEVICE_QUEUE_COUNT, selected_indices);
                     extensions_optional =
                         get_supported_opt_ext(physical_device, extensions, create_ctx->device_extensions_optional);
                     runtime_data.properties2.pNext = create_ctx->device_physical_next;
@@ -258,6 +269,7 @@ namespace agrb
                         max_rating = rating;
                         extensions_optional = opt_tmp;
                         physical_device = device;
+                        std::copy_n(indices, DEVICE_QUEUE_COUNT, selected_indices);
                     }
                 }
             }
@@ -266,13 +278,16 @@ namespace agrb
         }
 
         if (create_ctx->ph_selector) create_ctx->ph_selector->response(true, &physical_device, loader);
-        queues.graphics.family_id = indices[DEVICE_QUEUE_GRAPHICS];
-        queues.present.family_id = indices[DEVICE_QUEUE_PRESENT];
-        queues.compute.family_id = indices[DEVICE_QUEUE_COMPUTE];
+        queues.graphics.family_id = selected_indices[DEVICE_QUEUE_GRAPHICS];
+        queues.present.family_id = selected_indices[DEVICE_QUEUE_PRESENT];
+        queues.compute.family_id = selected_indices[DEVICE_QUEUE_COMPUTE];
+        queues.transfer.family_id = selected_indices[DEVICE_QUEUE_TRANSFER];
         for (auto *extension : extensions_optional) runtime_data._extensions.emplace(extension);
 
         runtime_data.memory_properties = physical_device.getMemoryProperties(loader);
 
+        // The list is global, a device created earlier in the process must not leave its extensions behind
+        using_extensitions.clear();
         using_extensitions.insert(using_extensitions.end(), create_ctx->device_extensions.begin(),
                                   create_ctx->device_extensions.end());
         using_extensitions.insert(using_extensitions.end(), extensions_optional.begin(), extensions_optional.end());
@@ -288,17 +303,37 @@ namespace agrb
     void device_initializer::find_queue_families(std::optional<u32> *dst, vk::PhysicalDevice device)
     {
         auto queueFamilies = device.getQueueFamilyProperties(loader);
+        for (int q = 0; q < DEVICE_QUEUE_COUNT; ++q) dst[q].reset();
 
+        const bool check_present = create_ctx->present_ctx != nullptr;
+        bool complete = false;
+        std::optional<u32> async_compute;
         int i = 0;
         for (const auto &queueFamily : queueFamilies)
         {
-            if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) dst[DEVICE_QUEUE_GRAPHICS] = i;
-            if (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) dst[DEVICE_QUEUE_COMPUTE] = i;
-            if (create_ctx->present_ctx)
-                if (device.getSurfaceSupportKHR(i, surface, loader)) dst[DEVICE_QUEUE_PRESENT] = i;
-            if (is_family_indices_complete(dst, create_ctx->present_ctx != nullptr)) break;
+            // Once graphics, compute and present are found, later families are only scanned for the dedicated
+            // compute and transfer ones, so the selection of the other queues does not depend on them.
+            if (!complete)
+            {
+                if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) dst[DEVICE_QUEUE_GRAPHICS] = i;
+                if (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) dst[DEVICE_QUEUE_COMPUTE] = i;
+                if (check_present)
+                    if (device.getSurfaceSupportKHR(i, surface, loader)) dst[DEVICE_QUEUE_PRESENT] = i;
+                complete = is_family_indices_complete(dst, check_present);
+            }
+            // Compute families without graphics run asynchronously to rendering
+            if (!async_compute.has_value() && (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) &&
+                !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics))
+                async_compute = i;
+            // Transfer-only families usually map to the DMA engines of discrete GPUs
+            if (!dst[DEVICE_QUEUE_TRANSFER].has_value() && (queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) &&
+                !(queueFamily.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+                dst[DEVICE_QUEUE_TRANSFER] = i;
+            if (complete && async_compute.has_value() && dst[DEVICE_QUEUE_TRANSFER].has_value()) break;
             i++;
         }
+        // The compute queue falls back to a graphics capable family only if there is no dedicated one
+        if (async_compute.has_value()) dst[DEVICE_QUEUE_COMPUTE] = async_compute;
     }
 
     bool device_initializer::is_device_suitable(vk::PhysicalDevice device,
@@ -336,6 +371,13 @@ namespace agrb
         return vk::SampleCountFlagBits::e1;
     }
 
+    static VkBaseOutStructure *find_chain_struct(void *next, vk::StructureType type)
+    {
+        for (auto *it = reinterpret_cast<VkBaseOutStructure *>(next); it; it = it->pNext)
+            if (it->sType == static_cast<VkStructureType>(type)) return it;
+        return nullptr;
+    }
+
     void device_initializer::create_logical_device()
     {
         acul::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
@@ -343,6 +385,7 @@ namespace agrb
         assert(queues.graphics.family_id.has_value() && queues.compute.family_id.has_value());
         acul::set<u32> unique_queue_families = {queues.graphics.family_id.value(), queues.compute.family_id.value()};
         if (create_ctx->present_ctx) unique_queue_families.insert(queues.present.family_id.value());
+        if (queues.transfer.family_id.has_value()) unique_queue_families.insert(queues.transfer.family_id.value());
         f32 queue_priority = 1.0f;
         for (u32 queue_family : unique_queue_families)
             queue_create_infos.emplace_back(vk::DeviceQueueCreateFlags(), queue_family, 1, &queue_priority);
@@ -356,6 +399,95 @@ namespace agrb
             device_logical_next = it->feature;
         }
 
+        auto &features = runtime_data.features;
+        vk::PhysicalDeviceFeatures core_features = create_ctx->device_features;
+        if (auto *features2 = find_chain_struct(device_logical_next, vk::PhysicalDeviceFeatures2::structureType))
+            core_features = reinterpret_cast<vk::PhysicalDeviceFeatures2 *>(features2)->features;
+        features.tessellation_shader = core_features.tessellationShader;
+        features.geometry_shader = core_features.geometryShader;
+
+        // Timeline semaphores are core since Vulkan 1.2, but the feature still has to be enabled explicitly.
+        // Respect the application's choice if it already chains the feature itself.
+        vk::PhysicalDeviceTimelineSemaphoreFeatures timeline_features;
+        using features12_t = vk::PhysicalDeviceVulkan12Features;
+        using timeline_features_t = vk::PhysicalDeviceTimelineSemaphoreFeatures;
+        if (auto *features12 = find_chain_struct(device_logical_next, features12_t::structureType))
+            features.timeline_semaphores = reinterpret_cast<features12_t *>(features12)->timelineSemaphore;
+        else if (auto *chained = find_chain_struct(device_logical_next, timeline_features_t::structureType))
+            features.timeline_semaphores = reinterpret_cast<timeline_features_t *>(chained)->timelineSemaphore;
+        else
+        {
+            vk::PhysicalDeviceFeatures2 features2;
+            features2.setPNext(&timeline_features);
+            physical_device.getFeatures2(&features2, loader);
+            features.timeline_semaphores = timeline_features.timelineSemaphore;
+            if (features.timeline_semaphores)
+            {
+                timeline_features.setPNext(device_logical_next);
+                device_logical_next = &timeline_features;
+            }
+        }
+
+        // Synchronization2 needs VK_KHR_synchronization2 on a Vulkan 1.2 device. Enable the feature when the
+        // application requested the extension without chaining the feature struct.
+        vk::PhysicalDeviceSynchronization2Features sync2_features;
+        using sync2_features_t = vk::PhysicalDeviceSynchronization2Features;
+        bool sync2_extension = std::any_of(using_extensitions.begin(), using_extensitions.end(), [](const char *ext) {
+            return strcmp(ext, vk::KHRSynchronization2ExtensionName) == 0;
+        });
+        if (!sync2_extension)
+            features.synchronization2 = false;
+        else if (auto *chained = find_chain_struct(device_logical_next, sync2_features_t::structureType))
+            features.synchronization2 = reinterpret_cast<sync2_features_t *>(chained)->synchronization2;
+        else
+        {
+            vk::PhysicalDeviceFeatures2 features2;
+            features2.setPNext(&sync2_features);
+            physical_device.getFeatures2(&features2, loader);
+            features.synchronization2 = sync2_features.synchronization2;
+            if (features.synchronization2)
+            {
+                sync2_features.setPNext(device_logical_next);
+                device_logical_next = &sync2_features;
+            }
+        }
+
+        // Buffer device address is core since Vulkan 1.2 but opt-in. Only the base feature is enabled, the query
+        // also reports capture replay and multi-device support.
+        vk::PhysicalDeviceBufferDeviceAddressFeatures bda_features;
+        using bda_features_t = vk::PhysicalDeviceBufferDeviceAddressFeatures;
+        if (auto *features12 = find_chain_struct(device_logical_next, features12_t::structureType))
+            features.buffer_device_address = reinterpret_cast<features12_t *>(features12)->bufferDeviceAddress;
+        else if (auto *chained = find_chain_struct(device_logical_next, bda_features_t::structureType))
+            features.buffer_device_address = reinterpret_cast<bda_features_t *>(chained)->bufferDeviceAddress;
+        else if (create_ctx->buffer_device_address)
+        {
+            vk::PhysicalDeviceFeatures2 features2;
+            features2.setPNext(&bda_features);
+            physical_device.getFeatures2(&features2, loader);
+            features.buffer_device_address = bda_features.bufferDeviceAddress;
+            bda_features.setBufferDeviceAddressCaptureReplay(false).setBufferDeviceAddressMultiDevice(false);
+            if (features.buffer_device_address)
+            {
+                bda_features.setPNext(device_logical_next);
+                device_logical_next = &bda_features;
+            }
+        }
+
+        // VMA reads heap budgets through VK_EXT_memory_budget, enable it whenever the device exposes it.
+        features.memory_budget = std::any_of(using_extensitions.begin(), using_extensitions.end(), [](const char *ext) {
+            return strcmp(ext, vk::EXTMemoryBudgetExtensionName) == 0;
+        });
+        if (!features.memory_budget)
+        {
+            auto available_extensions = physical_device.enumerateDeviceExtensionProperties(nullptr, loader);
+            features.memory_budget =
+                std::any_of(available_extensions.begin(), available_extensions.end(), [](const auto &extension) {
+                    return strcmp(extension.extensionName.data(), vk::EXTMemoryBudgetExtensionName) == 0;
+                });
+            if (features.memory_budget) using_extensitions.push_back(vk::EXTMemoryBudgetExtensionName);
+        }
+
         vk::DeviceCreateInfo create_info;
         create_info.setQueueCreateInfoCount(static_cast<u32>(queue_create_infos.size()))
             .setPQueueCreateInfos(queue_create_infos.data())
@@ -369,6 +501,8 @@ namespace agrb
         queues.compute.vk_queue = device.getQueue(queues.compute.family_id.value(), 0, loader);
         if (create_ctx->present_ctx)
             queues.present.vk_queue = device.getQueue(queues.present.family_id.value(), 0, loader);
+        if (queues.transfer.family_id.has_value())
+            queues.transfer.vk_queue = device.getQueue(queues.transfer.family_id.value(), 0, loader);
     }
 
     void device_initializer::create_allocator()
@@ -386,6 +520,9 @@ namespace agrb
         allocatorInfo.pVulkanFunctions = &vma_functions;
         allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2;
         allocatorInfo.flags = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT;
+        if (runtime_data.features.memory_budget) allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        if (runtime_data.features.buffer_device_address)
+            allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
         if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS)
             throw acul::runtime_error("Failed to create memory allocator");
     }
@@ -451,7 +588,7 @@ namespace agrb
 
         dst.secondary.allocator.device = &device;
         dst.secondary.allocator.loader = &loader;
-        dst.secondary.allocator.command_pool = &runtime_data.queues.graphics.pool.vk_pool;
+        dst.secondary.allocator.command_pool = &dst.vk_pool;
         dst.secondary.allocate(secondary);
     }
 
@@ -469,5 +606,15 @@ namespace agrb
             .setFlags(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
             .setQueueFamilyIndex(queues.compute.family_id.value());
         allocate_cmd_buf_pool(compute_pool_info, queues.compute.pool, 2, 2);
+
+        if (queues.transfer.family_id.has_value())
+        {
+            vk::CommandPoolCreateInfo transfer_pool_info;
+            transfer_pool_info
+                .setFlags(vk::CommandPoolCreateFlagBits::eTransient |
+                          vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+                .setQueueFamilyIndex(queues.transfer.family_id.value());
+            allocate_cmd_buf_pool(transfer_pool_info, queues.transfer.pool, 2, 0);
+        }
     }
 } // namespace agrb
@@ -433,6 +433,10 @@ namespace agrb
             allocator_info.pVulkanFunctions = &vma_functions;
             allocator_info.vulkanApiVersion = VK_API_VERSION_1_2;
             allocator_info.flags = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT;
+            if (device.rd && device.rd->features.memory_budget)
+                allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+            if (device.rd && device.rd->features.buffer_device_address)
+                allocator_info.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
             return vmaCreateAllocator(&allocator_info, &device.allocator) == VK_SUCCESS;
         }
     } // namespace
@@ -461,6 +465,11 @@ namespace agrb
             queues.present.family_id = create_info.present_family_id;
             queues.present.vk_queue = create_info.present_queue;
         }
+        if (create_info.has_transfer_queue)
+        {
+            queues.transfer.family_id = create_info.transfer_family_id;
+            queues.transfer.vk_queue = create_info.transfer_queue;
+        }
 
         device.rd->properties2 = device.physical_device.getProperties2(device.loader);
         device.rd->memory_properties = device.physical_device.getMemoryProperties(device.loader);
@@ -471,6 +480,8 @@ namespace agrb
                                 create_info.graphics_secondary_buffers);
             create_command_pool(device, queues.compute, create_info.compute_primary_buffers,
                                 create_info.compute_secondary_buffers);
+            if (create_info.has_transfer_queue && create_info.transfer_family_id != create_info.graphics_family_id)
+                create_command_pool(device, queues.transfer, create_info.transfer_primary_buffers, 0);
         }
 
         if (create_info.create_fence_pool)
@@ -481,6 +492,9 @@ namespace agrb
             fence_pool.allocate(create_info.fence_pool_size);
         }
 
+        device.rd->features = create_info.features;
+        if (create_info.features.timeline_semaphores) queues.create_timelines(device.vk_device, device.loader);
+
         device.allocator = create_info.allocator;
     }
 
@@ -489,8 +503,12 @@ namespace agrb
         if (!device.rd) return;
 
         auto &queues = device.rd->queues;
-        if (queues.graphics.pool.vk_pool || queues.compute.pool.vk_pool)
+        queues.wait_timelines(device.vk_device, device.loader);
+        if (queues.graphics.pool.vk_pool || queues.compute.pool.vk_pool || queues.transfer.pool.vk_pool)
             queues.destroy(device.vk_device, device.loader);
+        else
+            for (auto *queue : {&queues.graphics, &queues.compute, &queues.transfer})
+                queue->timeline.destroy(device.vk_device, device.loader);
 
         auto &fence_pool = device.rd->fence_pool;
         if (fence_pool.allocator.device) fence_pool.destroy();
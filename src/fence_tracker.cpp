@@ -0,0 +1,104 @@
+#include <agrb/fence_tracker.hpp>
+#include <chrono>
+#include <thread>
+
+namespace agrb
+{
+    vk::Fence fence_tracker::acquire(id &out, acul::unique_function<void(vk::Result)> &&on_complete)
+    {
+        // Pooled fences are created signaled and returned signaled, so they are reset when handed out.
+        _in_flight.emplace_back();
+        auto &entry = _in_flight.back();
+        _device.rd->fence_pool.request(&entry.fence, 1, &entry.handle);
+        _device.vk_device.resetFences(entry.fence, _device.loader);
+        entry.fence_id = _next_id++;
+        entry.on_complete = std::move(on_complete);
+        out = entry.fence_id;
+        return entry.fence;
+    }
+
+    size_t fence_tracker::reclaim(const acul::vector<vk::Result> &statuses)
+    {
+        acul::vector<tracked_fence> done;
+        acul::vector<vk::Result> results;
+        size_t kept = 0;
+        for (size_t i = 0; i < _in_flight.size(); ++i)
+        {
+            if (statuses[i] == vk::Result::eNotReady)
+            {
+                if (kept != i) _in_flight[kept] = std::move(_in_flight[i]);
+                ++kept;
+                continue;
+            }
+            done.push_back(std::move(_in_flight[i]));
+            results.push_back(statuses[i]);
+        }
+        _in_flight.resize(kept);
+
+        auto &pool = _device.rd->fence_pool;
+        for (auto &entry : done) pool.release(entry.handle);
+        // Callbacks run once the tracker is consistent again, so they may acquire new fences.
+        for (size_t i = 0; i < done.size(); ++i)
+            if (done[i].on_complete) done[i].on_complete(results[i]);
+        return done.size();
+    }
+
+    size_t fence_tracker::collect()
+    {
+        if (_in_flight.empty()) return 0;
+        acul::vector<vk::Result> statuses(_in_flight.size());
+        for (size_t i = 0; i < _in_flight.size(); ++i)
+            statuses[i] = _device.vk_device.getFenceStatus(_in_flight[i].fence, _device.loader);
+        return reclaim(statuses);
+    }
+
+    vk::Result fence_tracker::wait(const id *ids, size_t count, bool all, u64 timeout, const fence_wait_policy &policy)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        auto elapsed = [start]() {
+            return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+        };
+
+        // Pending fences of the set. Collected ids are already signaled.
+        acul::vector<vk::Fence> pending;
+        auto gather = [&]() {
+            pending.clear();
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t index = find(ids[i]);
+                if (index != _in_flight.size()) pending.push_back(_in_flight[index].fence);
+            }
+        };
+        auto satisfied = [&]() { return pending.empty() || (!all && pending.size() < count); };
+
+        // Spin phase: cheap for submissions that are about to finish, avoids a sleep/wake round trip.
+        gather();
+        while (!satisfied() && elapsed() < std::min(policy.spin_ns, timeout))
+        {
+            collect();
+            gather();
+            if (!satisfied()) std::this_thread::yield();
+        }
+        if (satisfied()) return vk::Result::eSuccess;
+
+        // Sleep phase: let the driver block until the fences are signaled.
+        u64 spent = elapsed();
+        u64 remaining = timeout == UINT64_MAX ? UINT64_MAX : (timeout > spent ? timeout - spent : 0);
+        auto res = _device.vk_device.waitForFences(static_cast<u32>(pending.size()), pending.data(), all, remaining,
+                                                   _device.loader);
+        collect();
+        return res;
+    }
+
+    void fence_tracker::flush()
+    {
+        if (_in_flight.empty()) return;
+        acul::vector<vk::Fence> fences(_in_flight.size());
+        for (size_t i = 0; i < _in_flight.size(); ++i) fences[i] = _in_flight[i].fence;
+        auto res = _device.vk_device.waitForFences(static_cast<u32>(fences.size()), fences.data(), true, UINT64_MAX,
+                                                   _device.loader);
+        acul::vector<vk::Result> statuses(_in_flight.size(), res);
+        reclaim(statuses);
+    }
+} // namespace agrb
@@ -0,0 +1,189 @@
+#include <agrb/frame.hpp>
+
+namespace agrb
+{
+    void frame_controller::create(device &device, u32 frames_in_flight)
+    {
+        assert(_frames.empty() && frames_in_flight > 0);
+        _device = &device;
+        _frames.resize(frames_in_flight);
+        _frame_index = 0;
+        _frame_number = 0;
+
+        vk::CommandPoolCreateInfo pool_info;
+        pool_info.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+            .setQueueFamilyIndex(device.rd->queues.graphics.family_id.value());
+        vk::FenceCreateInfo fence_info(vk::FenceCreateFlagBits::eSignaled);
+        for (auto &frame : _frames)
+        {
+            frame.command_pool = device.vk_device.createCommandPool(pool_info, nullptr, device.loader);
+            vk::CommandBufferAllocateInfo alloc_info(frame.command_pool, vk::CommandBufferLevel::ePrimary, 1);
+            if (device.vk_device.allocateCommandBuffers(&alloc_info, &frame.command_buffer, device.loader) !=
+                vk::Result::eSuccess)
+                throw acul::bad_alloc(1);
+            frame.image_available = device.vk_device.createSemaphore({}, nullptr, device.loader);
+            frame.in_flight = device.vk_device.createFence(fence_info, nullptr, device.loader);
+        }
+    }
+
+    void frame_controller::destroy()
+    {
+        if (_frames.empty()) return;
+        auto &vk_device = _device->vk_device;
+        for (auto &frame : _frames)
+        {
+            if (vk_device.waitForFences(frame.in_flight, true, UINT64_MAX, _device->loader) != vk::Result::eSuccess)
+                vk_device.waitIdle(_device->loader);
+            vk_device.destroyFence(frame.in_flight, nullptr, _device->loader);
+            vk_device.destroySemaphore(frame.image_available, nullptr, _device->loader);
+            vk_device.destroyCommandPool(frame.command_pool, nullptr, _device->loader);
+        }
+        // Presentation does not signal anything the host can wait for.
+        _device->rd->queues.graphics.vk_queue.waitIdle(_device->loader);
+        if (_device->rd->queues.present.vk_queue) _device->rd->queues.present.vk_queue.waitIdle(_device->loader);
+        for (auto semaphore : _render_finished) vk_device.destroySemaphore(semaphore, nullptr, _device->loader);
+        _render_finished.clear();
+        _frames.clear();
+        _frame_begin_callbacks.clear();
+    }
+
+    vk::Result frame_controller::begin(vk::SwapchainKHR swapchain, u64 timeout)
+    {
+        assert(!_recording);
+        auto &vk_device = _device->vk_device;
+        auto &frame = _frames[_frame_index];
+        auto res = vk_device.waitForFences(1, &frame.in_flight, true, timeout, _device->loader);
+        if (res != vk::Result::eSuccess) return res;
+
+        if (swapchain)
+        {
+            res = vk_device.acquireNextImageKHR(swapchain, timeout, frame.image_available, nullptr, &_image_index,
+                                                _device->loader);
+            if (res != vk::Result::eSuccess && res != vk::Result::eSuboptimalKHR) return res;
+        }
+        for (auto &callback : _frame_begin_callbacks) callback(_frame_index);
+
+        vk_device.resetCommandPool(frame.command_pool, {}, _device->loader);
+        vk::CommandBufferBeginInfo begin_info(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        frame.command_buffer.begin(begin_info, _device->loader);
+        _recording = true;
+        ++_frame_number;
+        return vk::Result::eSuccess;
+    }
+
+    vk::Result frame_controller::submit(bool acquired, vk::Semaphore render_finished)
+    {
+        assert(_recording);
+        _recording = false;
+        auto &vk_device = _device->vk_device;
+        auto &queues = _device->rd->queues;
+        auto &frame = _frames[_frame_index];
+        frame.command_buffer.end(_device->loader);
+
+        // The acquire semaphore comes first, followed by the cross-queue waits registered with wait_for().
+        acul::vector<vk::Semaphore> wait_semaphores;
+        acul::vector<u64> wait_values;
+        acul::vector<vk::PipelineStageFlags> wait_stages;
+        if (acquired)
+        {
+            wait_semaphores.push_back(frame.image_available);
+            wait_values.push_back(0);
+            wait_stages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        }
+        for (auto &wait : _waits)
+        {
+            wait_semaphores.push_back(wait.semaphore);
+            wait_values.push_back(wait.value);
+            wait_stages.push_back(wait.stage);
+        }
+        _waits.clear();
+
+        vk::Semaphore signal_semaphores[2];
+        u64 signal_values[2] = {0, 0};
+        u32 signal_count = 0;
+        if (render_finished) signal_semaphores[signal_count++] = render_finished;
+        vk::SubmitInfo submit_info;
+        submit_info.setWaitSemaphoreCount(static_cast<u32>(wait_semaphores.size()))
+            .setPWaitSemaphores(wait_semaphores.data())
+            .setPWaitDstStageMask(wait_stages.data())
+            .setCommandBufferCount(1)
+            .setPCommandBuffers(&frame.command_buffer)
+            .setPSignalSemaphores(signal_semaphores);
+
+        vk::TimelineSemaphoreSubmitInfo timeline_info;
+        frame.submitted = {};
+        if (queues.graphics.timeline.valid())
+        {
+            // Also signal the graphics timeline so per-frame work can be tracked like any other submission.
+            frame.submitted = {&queues.graphics.timeline, queues.graphics.timeline.next()};
+            signal_semaphores[signal_count] = queues.graphics.timeline.semaphore;
+            signal_values[signal_count++] = frame.submitted.value;
+            timeline_info.setWaitSemaphoreValueCount(static_cast<u32>(wait_values.size()))
+                .setPWaitSemaphoreValues(wait_values.data())
+                .setSignalSemaphoreValueCount(signal_count)
+                .setPSignalSemaphoreValues(signal_values);
+            submit_info.setPNext(&timeline_info);
+        }
+        submit_info.setSignalSemaphoreCount(signal_count);
+
+        // The fence is reset right before the submission that signals it, so a failed frame never leaves the slot
+        // with a fence the next begin_frame() would wait on forever.
+        auto res = vk_device.resetFences(1, &frame.in_flight, _device->loader);
+        if (res != vk::Result::eSuccess) return res;
+        res = queues.graphics.vk_queue.submit(1, &submit_info, frame.in_flight, _device->loader);
+        if (res == vk::Result::eSuccess) return res;
+
+        // Recover the slot with an empty submission: it consumes the acquire semaphore, reaches the timeline point
+        // handed out above and signals the fence.
+        vk::SubmitInfo recover_info;
+        recover_info.setWaitSemaphoreCount(acquired ? 1 : 0)
+            .setPWaitSemaphores(&frame.image_available)
+            .setPWaitDstStageMask(wait_stages.data());
+        vk::TimelineSemaphoreSubmitInfo recover_timeline;
+        u64 recover_wait_value = 0;
+        if (frame.submitted.valid())
+        {
+            recover_timeline.setWaitSemaphoreValueCount(acquired ? 1 : 0)
+                .setPWaitSemaphoreValues(&recover_wait_value)
+                .setSignalSemaphoreValueCount(1)
+                .setPSignalSemaphoreValues(&frame.submitted.value);
+            recover_info.setSignalSemaphoreCount(1)
+                .setPSignalSemaphores(&queues.graphics.timeline.semaphore)
+                .setPNext(&recover_timeline);
+        }
+        (void)queues.graphics.vk_queue.submit(1, &recover_info, frame.in_flight, _device->loader);
+        frame.submitted = {};
+        _frame_index = (_frame_index + 1) % static_cast<u32>(_frames.size());
+        return res;
+    }
+
+    vk::Result frame_controller::end_frame(vk::SwapchainKHR swapchain)
+    {
+        auto &vk_device = _device->vk_device;
+        while (_render_finished.size() <= _image_index)
+            _render_finished.push_back(vk_device.createSemaphore({}, nullptr, _device->loader));
+        vk::Semaphore render_finished = _render_finished[_image_index];
+        auto res = submit(true, render_finished);
+        if (res != vk::Result::eSuccess) return res;
+
+        vk::PresentInfoKHR present_info;
+        present_info.setWaitSemaphoreCount(1)
+            .setPWaitSemaphores(&render_finished)
+            .setSwapchainCount(1)
+            .setPSwapchains(&swapchain)
+            .setPImageIndices(&_image_index);
+        auto &queues = _device->rd->queues;
+        vk::Queue present_queue = queues.present.vk_queue ? queues.present.vk_queue : queues.graphics.vk_queue;
+        res = present_queue.presentKHR(&present_info, _device->loader);
+        _frame_index = (_frame_index + 1) % static_cast<u32>(_frames.size());
+        return res;
+    }
+
+    vk::Result frame_controller::end_offscreen_frame()
+    {
+        auto res = submit(false, nullptr);
+        if (res != vk::Result::eSuccess) return res;
+        _frame_index = (_frame_index + 1) % static_cast<u32>(_frames.size());
+        return res;
+    }
+} // namespace agrb
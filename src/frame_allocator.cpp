@@ -0,0 +1,94 @@
+#include <agrb/frame_allocator.hpp>
+#include <algorithm>
+
+namespace agrb
+{
+    bool frame_allocator::create(device &device, vk::DeviceSize frame_capacity, u32 frames,
+                                 vk::BufferUsageFlags usage)
+    {
+        assert(!valid() && frame_capacity > 0 && frames > 0);
+        auto &limits = device.rd->properties2.properties.limits;
+        _uniform_alignment = std::max<vk::DeviceSize>(16, limits.minUniformBufferOffsetAlignment);
+        _storage_alignment = std::max<vk::DeviceSize>(16, limits.minStorageBufferOffsetAlignment);
+
+        // Frame regions start on an alignment every allocation can use and on a non-coherent atom for flushes.
+        vk::DeviceSize region_alignment =
+            std::max({_uniform_alignment, _storage_alignment, limits.nonCoherentAtomSize});
+        _frame_capacity = get_alignment(frame_capacity, region_alignment);
+        _frames = frames;
+
+        _buffer.instance_count = frames;
+        _buffer.alignment_size = _frame_capacity;
+        _buffer.buffer_size = _frame_capacity * frames;
+        auto alloc_info = make_alloc_info(VMA_MEMORY_USAGE_CPU_TO_GPU, vk::MemoryPropertyFlagBits::eHostVisible,
+                                          vk::MemoryPropertyFlagBits::eHostCoherent);
+        if (!allocate_buffer(_buffer, alloc_info, usage, device)) return false;
+        if (!map_buffer(_buffer, device))
+        {
+            destroy_buffer(_buffer, device);
+            return false;
+        }
+        _device = &device;
+        _coherent = static_cast<bool>(get_allocation_memory_flags(device.allocator, _buffer.allocation) &
+                                      vk::MemoryPropertyFlagBits::eHostCoherent);
+        reset(0);
+        return true;
+    }
+
+    void frame_allocator::destroy()
+    {
+        if (!valid()) return;
+        destroy_buffer(_buffer, *_device);
+        _device = nullptr;
+    }
+
+    bool frame_allocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment, buffer &out)
+    {
+        assert(valid() && alignment > 0 && (alignment & (alignment - 1)) == 0);
+        // Frame regions are aligned to the device limits, so aligning the head aligns the absolute offset.
+        assert(_base % alignment == 0 && "Alignment exceeds the frame region alignment");
+        vk::DeviceSize head = _head.load(std::memory_order_relaxed);
+        vk::DeviceSize begin;
+        do
+        {
+            begin = get_alignment(head, alignment);
+            if (begin + size > _frame_capacity)
+            {
+                _overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!_head.compare_exchange_weak(head, begin + size, std::memory_order_relaxed));
+
+        vk::DeviceSize peak = _peak.load(std::memory_order_relaxed);
+        while (begin + size > peak && !_peak.compare_exchange_weak(peak, begin + size, std::memory_order_relaxed))
+            continue;
+
+        out = {};
+        out.instance_count = 1;
+        out.vk_buffer = _buffer.vk_buffer;
+        out.allocation = _buffer.allocation;
+        out.address = _buffer.address;
+        out.offset = _base + begin;
+        out.buffer_size = size;
+        out.alignment_size = size;
+        out.mapped = static_cast<char *>(_buffer.mapped) + out.offset;
+        return true;
+    }
+
+    vk::Result frame_allocator::flush()
+    {
+        vk::DeviceSize used = _head.load(std::memory_order_acquire);
+        if (_coherent || used == 0) return vk::Result::eSuccess;
+        return flush_buffer(_buffer, *_device, used, _base);
+    }
+
+    frame_allocator_stats frame_allocator::stats() const
+    {
+        frame_allocator_stats stats;
+        stats.frame_capacity = _frame_capacity;
+        stats.used = _head.load(std::memory_order_relaxed);
+        stats.peak_used = _peak.load(std::memory_order_relaxed);
+        stats.overflows = _overflows.load(std::memory_order_relaxed);
+        return stats;
+    }
+} // namespace agrb
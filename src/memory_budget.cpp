@@ -0,0 +1,55 @@
+#include <agrb/memory_budget.hpp>
+
+namespace agrb
+{
+    void get_heap_budgets(const device &device, acul::vector<heap_budget> &budgets)
+    {
+        const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+        vmaGetMemoryProperties(device.allocator, &memory_properties);
+        VmaBudget vma_budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets(device.allocator, vma_budgets);
+
+        budgets.resize(memory_properties->memoryHeapCount);
+        for (u32 i = 0; i < memory_properties->memoryHeapCount; ++i)
+        {
+            auto &dst = budgets[i];
+            dst.usage = vma_budgets[i].usage;
+            dst.budget = vma_budgets[i].budget;
+            dst.block_bytes = vma_budgets[i].statistics.blockBytes;
+            dst.allocation_bytes = vma_budgets[i].statistics.allocationBytes;
+            dst.flags = static_cast<vk::MemoryHeapFlags>(memory_properties->memoryHeaps[i].flags);
+        }
+    }
+
+    namespace detail
+    {
+        bool apply_memory_budget(const device &device, u32 memory_type, vk::DeviceSize size,
+                                 VmaAllocationCreateInfo &alloc_info)
+        {
+            auto *policy = device.rd ? device.rd->budget_policy : nullptr;
+            if (!policy) return false;
+
+            const VkPhysicalDeviceMemoryProperties *memory_properties = nullptr;
+            vmaGetMemoryProperties(device.allocator, &memory_properties);
+            u32 heap = memory_properties->memoryTypes[memory_type].heapIndex;
+            VmaBudget vma_budgets[VK_MAX_MEMORY_HEAPS];
+            vmaGetHeapBudgets(device.allocator, vma_budgets);
+            auto limit = static_cast<vk::DeviceSize>(static_cast<double>(vma_budgets[heap].budget) * policy->threshold);
+            if (vma_budgets[heap].usage + size > limit && policy->on_pressure)
+            {
+                heap_budget snapshot;
+                snapshot.usage = vma_budgets[heap].usage;
+                snapshot.budget = vma_budgets[heap].budget;
+                snapshot.block_bytes = vma_budgets[heap].statistics.blockBytes;
+                snapshot.allocation_bytes = vma_budgets[heap].statistics.allocationBytes;
+                snapshot.flags = static_cast<vk::MemoryHeapFlags>(memory_properties->memoryHeaps[heap].flags);
+                policy->on_pressure(heap, snapshot, size);
+            }
+
+            // Callers that restrict the allocation to the budget themselves are not retried.
+            if (alloc_info.flags & VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT) return false;
+            alloc_info.flags |= VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+            return policy->allow_over_budget;
+        }
+    } // namespace detail
+} // namespace agrb
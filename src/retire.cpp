@@ -0,0 +1,116 @@
+#include <agrb/retire.hpp>
+
+namespace agrb
+{
+    void retire_queue::push(const timeline_point &point, retired_object &&object)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        ++_size;
+        if (!point.valid())
+        {
+            _untracked.push_back(std::move(object));
+            return;
+        }
+        auto it = std::find_if(_buckets.begin(), _buckets.end(),
+                               [&point](const timeline_bucket &bucket) { return bucket.timeline == point.timeline; });
+        if (it == _buckets.end())
+        {
+            _buckets.emplace_back();
+            it = _buckets.end() - 1;
+            it->timeline = point.timeline;
+        }
+        it->entries.push({point.value, std::move(object)});
+    }
+
+    void retire_queue::release(retired_object &object)
+    {
+        auto &vk_device = _device.vk_device;
+        auto &loader = _device.loader;
+        switch (object.type)
+        {
+            case vk::ObjectType::eBuffer:
+                if (object.allocation)
+                    vmaDestroyBuffer(_device.allocator, reinterpret_cast<VkBuffer>(object.handle), object.allocation);
+                else
+                    vk_device.destroyBuffer(vk::Buffer(reinterpret_cast<VkBuffer>(object.handle)), nullptr, loader);
+                break;
+            case vk::ObjectType::eImage:
+                if (object.allocation)
+                    vmaDestroyImage(_device.allocator, reinterpret_cast<VkImage>(object.handle), object.allocation);
+                else
+                    vk_device.destroyImage(vk::Image(reinterpret_cast<VkImage>(object.handle)), nullptr, loader);
+                break;
+            case vk::ObjectType::eImageView:
+                vk_device.destroyImageView(vk::ImageView(reinterpret_cast<VkImageView>(object.handle)), nullptr,
+                                           loader);
+                break;
+            case vk::ObjectType::eSampler:
+                vk_device.destroySampler(vk::Sampler(reinterpret_cast<VkSampler>(object.handle)), nullptr, loader);
+                break;
+            case vk::ObjectType::ePipeline:
+                vk_device.destroyPipeline(vk::Pipeline(reinterpret_cast<VkPipeline>(object.handle)), nullptr, loader);
+                break;
+            case vk::ObjectType::eFramebuffer:
+                vk_device.destroyFramebuffer(vk::Framebuffer(reinterpret_cast<VkFramebuffer>(object.handle)),
+                                             nullptr, loader);
+                break;
+            case vk::ObjectType::eDescriptorSet:
+            {
+                vk::DescriptorSet set(reinterpret_cast<VkDescriptorSet>(object.handle));
+                vk::DescriptorPool pool(reinterpret_cast<VkDescriptorPool>(object.owner));
+                (void)vk_device.freeDescriptorSets(pool, 1, &set, loader);
+                break;
+            }
+            default:
+                if (object.release) object.release();
+                break;
+        }
+        --_size;
+    }
+
+    size_t retire_queue::collect()
+    {
+        acul::vector<retired_object> ready;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            for (auto &bucket : _buckets)
+            {
+                if (bucket.entries.empty()) continue;
+                u64 completed = bucket.timeline->completed(_device.vk_device, _device.loader);
+                while (!bucket.entries.empty() && bucket.entries.front().value <= completed)
+                {
+                    ready.push_back(std::move(bucket.entries.front().object));
+                    bucket.entries.pop();
+                }
+            }
+        }
+        // Objects are destroyed outside of the lock so that producers are not blocked by the driver.
+        for (auto &object : ready) release(object);
+        return ready.size();
+    }
+
+    void retire_queue::flush()
+    {
+        acul::vector<retired_object> ready;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            for (auto &bucket : _buckets)
+            {
+                if (bucket.entries.empty()) continue;
+                bucket.timeline->wait(bucket.timeline->last_value, _device.vk_device, _device.loader);
+                while (!bucket.entries.empty())
+                {
+                    ready.push_back(std::move(bucket.entries.front().object));
+                    bucket.entries.pop();
+                }
+            }
+            if (!_untracked.empty())
+            {
+                _device.vk_device.waitIdle(_device.loader);
+                for (auto &object : _untracked) ready.push_back(std::move(object));
+                _untracked.clear();
+            }
+        }
+        for (auto &object : ready) release(object);
+    }
+} // namespace agrb
@@ -0,0 +1,134 @@
+#include <agrb/submission.hpp>
+
+namespace agrb
+{
+    // How long the submit thread blocks on an in-flight submission before it checks for new jobs again.
+    static constexpr u64 in_flight_poll_timeout = 200000;
+
+    void submission_service::start()
+    {
+        assert(!running());
+        _stop = false;
+        _thread = std::thread(&submission_service::run, this);
+    }
+
+    void submission_service::stop()
+    {
+        if (!running()) return;
+        _stop = true;
+        {
+            std::lock_guard<std::mutex> lock(_wake_lock);
+            _wake.notify_one();
+        }
+        _thread.join();
+    }
+
+    void submission_service::notify()
+    {
+        // Pairs with the idle store of the submit thread: either it sees the new job before it goes to sleep,
+        // or we see it idle and wake it up.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!_idle.load()) return;
+        std::lock_guard<std::mutex> lock(_wake_lock);
+        _wake.notify_one();
+    }
+
+    std::future<vk::Result> submission_service::submit(submit_job &&job)
+    {
+        pending_job pending;
+        pending.job = std::move(job);
+        auto future = pending.promise.get_future();
+        _jobs.push(std::move(pending));
+        notify();
+        return future;
+    }
+
+    std::future<vk::Result> submission_service::upload(gpu_upload_info &&upload_info,
+                                                       acul::unique_function<void(vk::Result)> &&on_complete)
+    {
+        auto fail = []() {
+            std::promise<vk::Result> promise;
+            promise.set_value(vk::Result::eErrorOutOfDeviceMemory);
+            return promise.get_future();
+        };
+        if (!upload_info.valid()) return fail();
+
+        submit_job job;
+        job.on_complete = std::move(on_complete);
+        auto mem_flags = get_allocation_memory_flags(_device.allocator, upload_info.allocation);
+        if (mem_flags & vk::MemoryPropertyFlagBits::eHostVisible)
+        {
+            if (!copy_data_to_gpu_buffer_host_visible(upload_info, _device.allocator, mem_flags)) return fail();
+            job.record = [on_upload = std::move(upload_info.on_upload)](single_time_exec &exec) mutable {
+                if (on_upload) on_upload(exec, false);
+            };
+            return submit(std::move(job));
+        }
+
+        buffer staging;
+        if (upload_info.staging)
+        {
+            assert(upload_info.on_staging_request);
+            if (!upload_info.on_staging_request(upload_info.data, upload_info.size)) return fail();
+            staging = *upload_info.staging;
+        }
+        else
+        {
+            if (!create_staging_buffer(staging, upload_info.size, _device)) return fail();
+            write_to_buffer(staging, upload_info.data);
+            unmap_buffer(staging, _device);
+            job.on_complete = [staging, &device = _device,
+                               on_complete = std::move(job.on_complete)](vk::Result res) mutable {
+                destroy_buffer(staging, device);
+                if (on_complete) on_complete(res);
+            };
+        }
+        job.record = [staging, on_copy_staging = std::move(upload_info.on_copy_staging),
+                      on_upload = std::move(upload_info.on_upload)](single_time_exec &exec) mutable {
+            if (on_copy_staging) on_copy_staging(exec, staging);
+            if (on_upload) on_upload(exec, true);
+        };
+        return submit(std::move(job));
+    }
+
+    void submission_service::run()
+    {
+        acul::vector<exec_ticket> in_flight;
+        pending_job pending;
+        while (true)
+        {
+            while (_jobs.pop(pending))
+            {
+                auto &queue = pending.job.queue ? *pending.job.queue : _device.rd->queues.graphics;
+                single_time_exec exec{_device, queue};
+                if (pending.job.record) pending.job.record(exec);
+                exec_ticket ticket = exec.end_async();
+                ticket.then([on_complete = std::move(pending.job.on_complete),
+                             promise = std::move(pending.promise)](vk::Result res) mutable {
+                    if (on_complete) on_complete(res);
+                    promise.set_value(res);
+                });
+                in_flight.push_back(std::move(ticket));
+            }
+
+            in_flight.erase(std::remove_if(in_flight.begin(), in_flight.end(),
+                                           [](exec_ticket &ticket) { return ticket.ready(); }),
+                            in_flight.end());
+
+            if (!in_flight.empty())
+            {
+                in_flight.front().wait(in_flight_poll_timeout);
+                continue;
+            }
+            if (_stop && _jobs.empty()) break;
+
+            _idle = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(_wake_lock);
+                _wake.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+            }
+            _idle = false;
+        }
+    }
+} // namespace agrb
@@ -0,0 +1,156 @@
+#include <agrb/submit_batch.hpp>
+
+namespace agrb
+{
+    submit_batch::queue_batch &submit_batch::get_batch(queue_family_info &queue)
+    {
+        for (auto &batch : _queues)
+            if (batch.queue == &queue) return batch;
+        _queues.emplace_back();
+        _queues.back().queue = &queue;
+        return _queues.back();
+    }
+
+    void submit_batch::add(queue_family_info &queue, batch_submission &&submission)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto &batch = get_batch(queue);
+        ++_stats.submissions;
+
+        // Fold into the previous submission when no semaphore operation separates them.
+        if (!batch.submissions.empty() && batch.submissions.back().signals.empty() && submission.waits.empty())
+        {
+            auto &prev = batch.submissions.back();
+            prev.command_buffers.insert(prev.command_buffers.end(), submission.command_buffers.begin(),
+                                        submission.command_buffers.end());
+            prev.signals = std::move(submission.signals);
+            return;
+        }
+        batch.submissions.push_back(std::move(submission));
+    }
+
+    void submit_batch::signal_fence(queue_family_info &queue, vk::Fence fence)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto &batch = get_batch(queue);
+        assert(!batch.fence && "Only one fence can be signaled per queue and flush");
+        batch.fence = fence;
+    }
+
+    vk::Result submit_batch::flush()
+    {
+        acul::vector<queue_batch> queues;
+        submit_batch_stats stats;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            queues = std::move(_queues);
+            _queues.clear();
+            stats.submissions = _stats.submissions;
+            _stats = {};
+        }
+
+        vk::Result result = vk::Result::eSuccess;
+        for (auto &batch : queues)
+        {
+            stats.submit_infos += static_cast<u32>(batch.submissions.size());
+            ++stats.queue_submits;
+            auto res = _device.rd->features.synchronization2 ? submit2(batch) : submit(batch);
+            if (res != vk::Result::eSuccess && result == vk::Result::eSuccess) result = res;
+        }
+        _stats = stats;
+        return result;
+    }
+
+    vk::Result submit_batch::submit2(queue_batch &batch)
+    {
+        size_t semaphore_count = 0, command_buffer_count = 0;
+        for (auto &submission : batch.submissions)
+        {
+            semaphore_count += submission.waits.size() + submission.signals.size();
+            command_buffer_count += submission.command_buffers.size();
+        }
+
+        // Reserved up front: submit infos point into these arrays.
+        acul::vector<vk::SemaphoreSubmitInfo> semaphores;
+        acul::vector<vk::CommandBufferSubmitInfo> command_buffers;
+        acul::vector<vk::SubmitInfo2> infos;
+        semaphores.reserve(semaphore_count);
+        command_buffers.reserve(command_buffer_count);
+        infos.reserve(batch.submissions.size());
+        for (auto &submission : batch.submissions)
+        {
+            infos.emplace_back();
+            auto &info = infos.back();
+            info.setWaitSemaphoreInfoCount(static_cast<u32>(submission.waits.size()))
+                .setPWaitSemaphoreInfos(semaphores.data() + semaphores.size());
+            for (auto &wait : submission.waits) semaphores.emplace_back(wait.semaphore, wait.value, wait.stage);
+
+            info.setCommandBufferInfoCount(static_cast<u32>(submission.command_buffers.size()))
+                .setPCommandBufferInfos(command_buffers.data() + command_buffers.size());
+            for (auto command_buffer : submission.command_buffers) command_buffers.emplace_back(command_buffer);
+
+            info.setSignalSemaphoreInfoCount(static_cast<u32>(submission.signals.size()))
+                .setPSignalSemaphoreInfos(semaphores.data() + semaphores.size());
+            for (auto &signal : submission.signals)
+                semaphores.emplace_back(signal.semaphore, signal.value, signal.stage);
+        }
+        return batch.queue->vk_queue.submit2KHR(static_cast<u32>(infos.size()), infos.data(), batch.fence,
+                                                _device.loader);
+    }
+
+    vk::Result submit_batch::submit(queue_batch &batch)
+    {
+        size_t wait_count = 0, signal_count = 0;
+        for (auto &submission : batch.submissions)
+        {
+            wait_count += submission.waits.size();
+            signal_count += submission.signals.size();
+        }
+
+        acul::vector<vk::Semaphore> semaphores;
+        acul::vector<u64> values;
+        acul::vector<vk::PipelineStageFlags> wait_stages;
+        acul::vector<vk::TimelineSemaphoreSubmitInfo> timeline_infos;
+        acul::vector<vk::SubmitInfo> infos;
+        semaphores.reserve(wait_count + signal_count);
+        values.reserve(wait_count + signal_count);
+        wait_stages.reserve(wait_count);
+        timeline_infos.reserve(batch.submissions.size());
+        infos.reserve(batch.submissions.size());
+        for (auto &submission : batch.submissions)
+        {
+            timeline_infos.emplace_back();
+            infos.emplace_back();
+            auto &timeline_info = timeline_infos.back();
+            auto &info = infos.back();
+            info.setPNext(&timeline_info);
+
+            info.setWaitSemaphoreCount(static_cast<u32>(submission.waits.size()))
+                .setPWaitSemaphores(semaphores.data() + semaphores.size())
+                .setPWaitDstStageMask(wait_stages.data() + wait_stages.size());
+            timeline_info.setWaitSemaphoreValueCount(static_cast<u32>(submission.waits.size()))
+                .setPWaitSemaphoreValues(values.data() + values.size());
+            for (auto &wait : submission.waits)
+            {
+                semaphores.push_back(wait.semaphore);
+                values.push_back(wait.value);
+                wait_stages.push_back(to_legacy_stages(wait.stage, _device.rd->features));
+            }
+
+            info.setCommandBufferCount(static_cast<u32>(submission.command_buffers.size()))
+                .setPCommandBuffers(submission.command_buffers.data());
+
+            info.setSignalSemaphoreCount(static_cast<u32>(submission.signals.size()))
+                .setPSignalSemaphores(semaphores.data() + semaphores.size());
+            timeline_info.setSignalSemaphoreValueCount(static_cast<u32>(submission.signals.size()))
+                .setPSignalSemaphoreValues(values.data() + values.size());
+            for (auto &signal : submission.signals)
+            {
+                semaphores.push_back(signal.semaphore);
+                values.push_back(signal.value);
+            }
+        }
+        return batch.queue->vk_queue.submit(static_cast<u32>(infos.size()), infos.data(), batch.fence,
+                                            _device.loader);
+    }
+} // namespace agrb
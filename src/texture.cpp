@@ -22,7 +22,7 @@ namespace agrb
 
         auto create_info =
             make_alloc_info(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, 0.5f);
-        return create_image(image_info, texture.image, texture.allocation, device.allocator, create_info);
+        return create_image(image_info, texture.image, texture.allocation, device, create_info);
     }
 
     void generate_texture_mipmaps(agrb::single_time_exec &exec, texture &texture)
@@ -134,7 +134,12 @@ namespace agrb
             if (!staging.vk_buffer) return;
             transition_image_layout(exec, texture.image, vk::ImageLayout::eUndefined,
                                     vk::ImageLayout::eTransferDstOptimal, texture.mip_levels);
-            copy_buffer_to_image(exec, staging.vk_buffer, texture.image, 1, texture.image_extent);
+            copy_buffer_to_image(exec, staging.vk_buffer, texture.image, 1, texture.image_extent, {0, 0, 0},
+                                 staging.offset);
+        };
+        upload_info.on_ownership_transfer = [&](single_time_exec &exec, const queue_ownership &ownership) {
+            image_ownership_barrier(exec, ownership, texture.image, vk::ImageLayout::eTransferDstOptimal,
+                                    texture.mip_levels);
         };
         upload_info.on_upload = [&](single_time_exec &exec, bool) {
             if (texture.mip_levels > 1)
@@ -168,7 +173,7 @@ namespace agrb
         upload_info.on_copy_staging = [extent, offset, &texture](single_time_exec &exec, buffer &staging) {
             transition_image_layout(exec, texture.image, vk::ImageLayout::eShaderReadOnlyOptimal,
                                     vk::ImageLayout::eTransferDstOptimal, 1);
-            copy_buffer_to_image(exec, staging.vk_buffer, texture.image, 1, extent, offset);
+            copy_buffer_to_image(exec, staging.vk_buffer, texture.image, 1, extent, offset, staging.offset);
         };
         upload_info.on_upload = [&texture](single_time_exec &exec, bool) {
             transition_image_layout(exec, texture.image, vk::ImageLayout::eTransferDstOptimal,
@@ -1,4 +1,6 @@
+#include <agrb/memory_budget.hpp>
 #include <agrb/utils/buffer.hpp>
+#include <agrb/utils/staging.hpp>
 
 #define MEM_DEDICATTED_ALLOC_MIN 536870912u
 
@@ -7,40 +9,138 @@ namespace agrb
     bool create_buffer(vk::DeviceSize size, vk::BufferUsageFlags vk_usage, vk::Buffer &buffer,
                        VmaAllocationCreateInfo alloc_info, VmaAllocation &allocation, const device &device)
     {
+        if ((vk_usage & vk::BufferUsageFlagBits::eShaderDeviceAddress) &&
+            (!device.rd || !device.rd->features.buffer_device_address))
+            return false;
         vk::BufferCreateInfo buffer_info;
         buffer_info.setSize(size).setUsage(vk_usage).setSharingMode(vk::SharingMode::eExclusive);
-        if (size > MEM_DEDICATTED_ALLOC_MIN) alloc_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
-        return vmaCreateBuffer(device.allocator, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info),
-                               &alloc_info, reinterpret_cast<VkBuffer *>(&buffer), &allocation, nullptr) == VK_SUCCESS;
+        if (size > MEM_DEDICATTED_ALLOC_MIN) alloc_info.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        auto *vk_buffer_info = reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info);
+        auto allocate = [&](const VmaAllocationCreateInfo &info) {
+            return vmaCreateBuffer(device.allocator, vk_buffer_info, &info, reinterpret_cast<VkBuffer *>(&buffer),
+                                   &allocation, nullptr);
+        };
+        u32 memory_type = 0;
+        if (!device.rd || !device.rd->budget_policy ||
+            vmaFindMemoryTypeIndexForBufferInfo(device.allocator, vk_buffer_info, &alloc_info, &memory_type) !=
+                VK_SUCCESS)
+            return allocate(alloc_info) == VK_SUCCESS;
+        return allocate_within_budget(device, memory_type, size, alloc_info, allocate) == VK_SUCCESS;
     }
 
-    bool copy_data_to_gpu_buffer_host_visible(const gpu_upload_info &upload_info, VmaAllocator &allocator,
-                                              vk::MemoryPropertyFlags mem_flags)
+    vk::Result flush_dirty_ranges(device &device, buffer *const *buffers, size_t count)
     {
-        void *dst = nullptr;
-        if (vmaMapMemory(allocator, upload_info.allocation, &dst) != VK_SUCCESS) return false;
-        memcpy(dst, upload_info.data, upload_info.size);
-
-        if (!(mem_flags & vk::MemoryPropertyFlagBits::eHostCoherent))
+        acul::vector<VmaAllocation> allocations;
+        acul::vector<VkDeviceSize> offsets, sizes;
+        for (size_t i = 0; i < count; ++i)
         {
-            if (vmaFlushAllocation(allocator, upload_info.allocation, 0, VK_WHOLE_SIZE) != VK_SUCCESS)
+            auto &tracker = buffers[i]->dirty_ranges;
+            if (!tracker || tracker->empty()) continue;
+            tracker->merge(buffers[i]->buffer_size);
+            for (auto &range : tracker->ranges)
             {
-                vmaUnmapMemory(allocator, upload_info.allocation);
-                return false;
+                allocations.push_back(buffers[i]->allocation);
+                offsets.push_back(buffers[i]->offset + range.begin);
+                sizes.push_back(range.end - range.begin);
             }
+            tracker->ranges.clear();
         }
+        if (allocations.empty()) return vk::Result::eSuccess;
+        return static_cast<vk::Result>(vmaFlushAllocations(device.allocator, static_cast<u32>(allocations.size()),
+                                                           allocations.data(), offsets.data(), sizes.data()));
+    }
 
-        vmaUnmapMemory(allocator, upload_info.allocation);
+    bool create_staging_buffer(buffer &staging, vk::DeviceSize size, device &device)
+    {
+        staging.instance_count = 1;
+        auto st_alloc_info = make_alloc_info(VMA_MEMORY_USAGE_CPU_ONLY, vk::MemoryPropertyFlagBits::eHostVisible,
+                                             vk::MemoryPropertyFlagBits::eHostCoherent, 0.1f);
+        construct_buffer(staging, size);
+        if (!allocate_buffer(staging, st_alloc_info, vk::BufferUsageFlagBits::eTransferSrc, device)) return false;
+        if (!map_buffer(staging, device))
+        {
+            destroy_buffer(staging, device);
+            return false;
+        }
         return true;
     }
 
+    // Write the payload through the persistent mapping of the allocation, or through a temporary one
+    static inline bool write_host_visible(const gpu_upload_info &upload_info, VmaAllocator &allocator,
+                                          vk::MemoryPropertyFlags mem_flags, bool overlapping)
+    {
+        VmaAllocationInfo alloc_info{};
+        vmaGetAllocationInfo(allocator, upload_info.allocation, &alloc_info);
+        void *dst = alloc_info.pMappedData;
+        bool temporary_mapping = !dst;
+        if (temporary_mapping && vmaMapMemory(allocator, upload_info.allocation, &dst) != VK_SUCCESS) return false;
+        dst = static_cast<char *>(dst) + upload_info.offset;
+        if (overlapping)
+            memmove(dst, upload_info.data, upload_info.size);
+        else
+            memcpy(dst, upload_info.data, upload_info.size);
+
+        bool is_success = true;
+        if (!(mem_flags & vk::MemoryPropertyFlagBits::eHostCoherent))
+            is_success = vmaFlushAllocation(allocator, upload_info.allocation, upload_info.offset, upload_info.size) ==
+                         VK_SUCCESS;
+        if (temporary_mapping) vmaUnmapMemory(allocator, upload_info.allocation);
+        return is_success;
+    }
+
+    bool copy_data_to_gpu_buffer_host_visible(const gpu_upload_info &upload_info, VmaAllocator &allocator,
+                                              vk::MemoryPropertyFlags mem_flags)
+    {
+        return write_host_visible(upload_info, allocator, mem_flags, false);
+    }
+
+    // Submit the commands reading a staging range of the ring and hand the range back to the ring
+    static inline vk::Result end_staged(single_time_exec &exec, const buffer &staging, staging_ring *ring)
+    {
+        if (!ring) return exec.end();
+        exec_ticket ticket = exec.end_async();
+        ring->retire(staging, ticket);
+        return ticket.wait();
+    }
+
     static inline bool data_to_gpu_buffer_by_staging(const gpu_upload_info &upload_info, buffer &staging,
-                                                     device &device)
+                                                     device &device, staging_ring *ring = nullptr)
     {
+        auto &queues = device.rd->queues;
+        if (upload_info.on_ownership_transfer && queues.has_dedicated_transfer())
+        {
+            queue_ownership ownership{queues.transfer.family_id.value(), queues.graphics.family_id.value()};
+            single_time_exec transfer_exec{device, queues.transfer};
+            if (upload_info.on_copy_staging) upload_info.on_copy_staging(transfer_exec, staging);
+            upload_info.on_ownership_transfer(transfer_exec, ownership);
+            exec_ticket transfer_ticket = transfer_exec.end_async();
+            if (ring) ring->retire(staging, transfer_ticket);
+
+            single_time_exec exec{device};
+            exec.wait_for(transfer_ticket, vk::PipelineStageFlagBits::eAllCommands);
+            if (transfer_ticket.result() != vk::Result::eNotReady && transfer_ticket.result() != vk::Result::eSuccess)
+            {
+                exec.end();
+                return false;
+            }
+            upload_info.on_ownership_transfer(exec, ownership);
+            if (upload_info.on_upload) upload_info.on_upload(exec, true);
+            return exec.end() == vk::Result::eSuccess;
+        }
+
         single_time_exec exec{device};
         if (upload_info.on_copy_staging) upload_info.on_copy_staging(exec, staging);
         if (upload_info.on_upload) upload_info.on_upload(exec, true);
-        return exec.end() == vk::Result::eSuccess;
+        return end_staged(exec, staging, ring) == vk::Result::eSuccess;
+    }
+
+    // Stage the payload in the device staging ring, if any. Returns nullptr when a dedicated buffer is needed
+    static inline staging_ring *stage_in_ring(const gpu_upload_info &upload_info, buffer &staging, device &device)
+    {
+        auto *ring = device.rd->staging;
+        if (!ring || !ring->allocate(upload_info.size, staging)) return nullptr;
+        ring->write(staging, upload_info.data, upload_info.size);
+        return ring;
     }
 
     bool copy_data_to_gpu_buffer_staging(const gpu_upload_info &upload_info, device &device)
@@ -54,16 +154,9 @@ namespace agrb
         else
         {
             buffer staging;
-            staging.instance_count = 1;
-            auto st_alloc_info = make_alloc_info(VMA_MEMORY_USAGE_CPU_ONLY, vk::MemoryPropertyFlagBits::eHostVisible,
-                                                 vk::MemoryPropertyFlagBits::eHostCoherent, 0.1f);
-            construct_buffer(staging, upload_info.size);
-            if (!allocate_buffer(staging, st_alloc_info, vk::BufferUsageFlagBits::eTransferSrc, device)) return false;
-            if (!map_buffer(staging, device))
-            {
-                destroy_buffer(staging, device);
-                return false;
-            }
+            if (auto *ring = stage_in_ring(upload_info, staging, device))
+                return data_to_gpu_buffer_by_staging(upload_info, staging, device, ring);
+            if (!create_staging_buffer(staging, upload_info.size, device)) return false;
             write_to_buffer(staging, upload_info.data);
             unmap_buffer(staging, device);
             bool is_success = data_to_gpu_buffer_by_staging(upload_info, staging, device);
@@ -93,22 +186,7 @@ namespace agrb
     bool move_data_to_gpu_buffer_host_visible(const gpu_upload_info &upload_info, VmaAllocator &allocator,
                                               vk::MemoryPropertyFlags mem_flags)
     {
-        void *dst = nullptr;
-        if (vmaMapMemory(allocator, upload_info.allocation, &dst) != VK_SUCCESS) return false;
-
-        memmove(dst, upload_info.data, upload_info.size);
-
-        if (!(mem_flags & vk::MemoryPropertyFlagBits::eHostCoherent))
-        {
-            if (vmaFlushAllocation(allocator, upload_info.allocation, 0, VK_WHOLE_SIZE) != VK_SUCCESS)
-            {
-                vmaUnmapMemory(allocator, upload_info.allocation);
-                return false;
-            }
-        }
-
-        vmaUnmapMemory(allocator, upload_info.allocation);
-        return true;
+        return write_host_visible(upload_info, allocator, mem_flags, true);
     }
 
     bool move_data_to_gpu_buffer_staging(const gpu_upload_info &upload_info, device &device)
@@ -121,19 +199,10 @@ namespace agrb
         }
 
         buffer staging;
-        staging.instance_count = 1;
-        auto st_alloc_info = make_alloc_info(VMA_MEMORY_USAGE_CPU_ONLY, vk::MemoryPropertyFlagBits::eHostVisible,
-                                             vk::MemoryPropertyFlagBits::eHostCoherent, 0.1f);
-
-        construct_buffer(staging, upload_info.size);
-        if (!allocate_buffer(staging, st_alloc_info, vk::BufferUsageFlagBits::eTransferSrc, device)) return false;
-
-        if (!map_buffer(staging, device))
-        {
-            destroy_buffer(staging, device);
-            return false;
-        }
-
+        // The payload cannot overlap the ring, so a plain copy is equivalent to the move here.
+        if (auto *ring = stage_in_ring(upload_info, staging, device))
+            return data_to_gpu_buffer_by_staging(upload_info, staging, device, ring);
+        if (!create_staging_buffer(staging, upload_info.size, device)) return false;
         move_to_buffer(staging, upload_info.data);
         unmap_buffer(staging, device);
 
@@ -2,19 +2,159 @@
 
 namespace agrb
 {
-    vk::Result single_time_exec::end()
+    namespace detail
     {
-        vk::Fence fence;
-        fence_pool.request(&fence, 1);
-        vk_device.resetFences(fence, loader);
-        command_buffer.end(loader);
+        bool exec_ticket_state::poll()
+        {
+            if (completed()) return true;
+            std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+            if (!guard.owns_lock() || completed()) return completed();
+            vk::Result res = vk::Result::eSuccess;
+            if (point.valid())
+            {
+                if (!point.timeline->reached(point.value, *vk_device, *loader)) return false;
+            }
+            else
+            {
+                res = vk_device->getFenceStatus(fence, *loader);
+                if (res == vk::Result::eNotReady) return false;
+            }
+            auto pending = complete(res);
+            guard.unlock();
+            for (auto &callback : pending) callback(res);
+            return true;
+        }
+
+        vk::Result exec_ticket_state::wait(u64 timeout)
+        {
+            if (completed()) return result;
+            std::unique_lock<std::mutex> guard(lock);
+            // Another thread may have completed the state while this one waited for the lock.
+            if (completed()) return result;
+            auto res = point.valid() ? point.timeline->wait(point.value, *vk_device, *loader, timeout)
+                                     : vk_device->waitForFences(fence, true, timeout, *loader);
+            if (res == vk::Result::eTimeout) return res;
+            auto pending = complete(res);
+            guard.unlock();
+            for (auto &callback : pending) callback(res);
+            return res;
+        }
+
+        void exec_ticket_state::add_callback(acul::unique_function<void(vk::Result)> &&callback)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!completed())
+                {
+                    callbacks.push_back(std::move(callback));
+                    return;
+                }
+            }
+            callback(result);
+        }
+
+        acul::vector<acul::unique_function<void(vk::Result)>> exec_ticket_state::complete(vk::Result res)
+        {
+            queue->pool.primary.release(command_buffer_id);
+            if (fence) fence_pool->release(fence_id);
+            command_buffer = nullptr;
+            fence = nullptr;
+            auto pending = std::move(callbacks);
+            callbacks.clear();
+            result.store(res, std::memory_order_release);
+            return pending;
+        }
+    } // namespace detail
+
+    bool exec_ticket::ready() { return _state ? _state->poll() : true; }
+
+    vk::Result exec_ticket::wait(u64 timeout) { return _state ? _state->wait(timeout) : vk::Result::eSuccess; }
+
+    void exec_ticket::then(acul::unique_function<void(vk::Result)> &&callback)
+    {
+        if (!_state)
+            callback(vk::Result::eSuccess);
+        else
+            _state->add_callback(std::move(callback));
+    }
+
+    // The submission never reached the queue: complete the ticket with the error, so that neither its waiters
+    // nor its destructor block on a fence or a timeline point nothing will signal.
+    static void abandon_submission(detail::exec_ticket_state &state, vk::Result res)
+    {
+        {
+            std::lock_guard<std::mutex> guard(state.lock);
+            state.complete(res);
+        }
+        auto &point = state.point;
+        if (!point.valid()) return;
+        // Hand the reserved value back unless a later submission has already reserved the next one. Then the value
+        // is reached from the host, otherwise waiting for the queue timeline would never return. Nothing here may
+        // throw, the submit error is being propagated.
+        u64 expected = point.value;
+        if (!point.timeline->last_value.compare_exchange_strong(expected, point.value - 1))
+        {
+            u64 completed = 0;
+            auto &vk_device = *state.vk_device;
+            if (vk_device.getSemaphoreCounterValue(point.timeline->semaphore, &completed, *state.loader) ==
+                    vk::Result::eSuccess &&
+                completed < point.value)
+            {
+                vk::SemaphoreSignalInfo signal_info(point.timeline->semaphore, point.value);
+                (void)vk_device.signalSemaphore(&signal_info, *state.loader);
+            }
+        }
+        point = {};
+    }
+
+    exec_ticket single_time_exec::end_async()
+    {
+        assert(!external && "External command buffers are submitted by their owner");
+        exec_ticket ticket;
+        ticket._state = acul::make_shared<detail::exec_ticket_state>();
+        auto &state = *ticket._state;
+        state.vk_device = &vk_device;
+        state.queue = &queue;
+        state.fence_pool = &fence_pool;
+        state.loader = &loader;
+        state.command_buffer = command_buffer;
+        state.command_buffer_id = command_buffer_id;
+
         vk::SubmitInfo submit_info;
         submit_info.commandBufferCount = 1;
         submit_info.pCommandBuffers = &command_buffer;
-        queue.vk_queue.submit(submit_info, fence, loader);
-        auto res = vk_device.waitForFences(fence, true, UINT64_MAX, loader);
-        queue.pool.primary.release(command_buffer);
-        fence_pool.release(fence);
-        return res;
+        vk::TimelineSemaphoreSubmitInfo timeline_info;
+        try
+        {
+            command_buffer.end(loader);
+            if (queue.timeline.valid())
+            {
+                state.point = {&queue.timeline, queue.timeline.next()};
+                timeline_info.setWaitSemaphoreValueCount(static_cast<u32>(_wait_values.size()))
+                    .setPWaitSemaphoreValues(_wait_values.data())
+                    .setSignalSemaphoreValueCount(1)
+                    .setPSignalSemaphoreValues(&state.point.value);
+                submit_info.setWaitSemaphoreCount(static_cast<u32>(_wait_semaphores.size()))
+                    .setPWaitSemaphores(_wait_semaphores.data())
+                    .setPWaitDstStageMask(_wait_stages.data())
+                    .setSignalSemaphoreCount(1)
+                    .setPSignalSemaphores(&queue.timeline.semaphore)
+                    .setPNext(&timeline_info);
+            }
+            else
+            {
+                fence_pool.request(&state.fence, 1, &state.fence_id);
+                vk_device.resetFences(state.fence, loader);
+            }
+            queue.vk_queue.submit(submit_info, state.fence, loader);
+        }
+        catch (const vk::SystemError &error)
+        {
+            abandon_submission(state, static_cast<vk::Result>(error.code().value()));
+            throw;
+        }
+        return ticket;
     }
-} // namespace agrb
\ No newline at end of file
+
+    vk::Result single_time_exec::end() { return end_async().wait(); }
+} // namespace agrb
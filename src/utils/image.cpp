@@ -1,3 +1,4 @@
+#include <agrb/memory_budget.hpp>
 #include <agrb/utils/image.hpp>
 
 namespace agrb
@@ -70,4 +71,21 @@ namespace agrb
         exec.command_buffer.pipelineBarrier(src_stage, dst_stage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1,
                                             &barrier, exec.loader);
     }
+
+    bool create_image(const vk::ImageCreateInfo &image_info, vk::Image &image, VmaAllocation &allocation,
+                      device &device, VmaAllocationCreateInfo alloc_info)
+    {
+        auto *vk_image_info = reinterpret_cast<const VkImageCreateInfo *>(&image_info);
+        auto allocate = [&](const VmaAllocationCreateInfo &info) {
+            return vmaCreateImage(device.allocator, vk_image_info, &info, reinterpret_cast<VkImage *>(&image),
+                                  &allocation, nullptr);
+        };
+        u32 memory_type = 0;
+        if (!device.rd || !device.rd->budget_policy ||
+            vmaFindMemoryTypeIndexForImageInfo(device.allocator, vk_image_info, &alloc_info, &memory_type) !=
+                VK_SUCCESS)
+            return allocate(alloc_info) == VK_SUCCESS;
+        // The size of an image is only known once it exists, so only the current heap usage is checked.
+        return allocate_within_budget(device, memory_type, 0, alloc_info, allocate) == VK_SUCCESS;
+    }
 } // namespace agrb
\ No newline at end of file
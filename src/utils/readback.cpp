@@ -0,0 +1,171 @@
+#include <agrb/utils/readback.hpp>
+
+namespace agrb
+{
+    readback_queue::~readback_queue()
+    {
+        flush();
+        for (auto &cached : _cache) destroy_buffer(cached, _device);
+    }
+
+    bool readback_queue::acquire_buffer(vk::DeviceSize size, buffer &dst)
+    {
+        // Readbacks of the same data recur every frame, so the smallest cached buffer that fits is reused.
+        size_t best = _cache.size();
+        for (size_t i = 0; i < _cache.size(); ++i)
+        {
+            if (_cache[i].buffer_size < size) continue;
+            if (best == _cache.size() || _cache[i].buffer_size < _cache[best].buffer_size) best = i;
+        }
+        if (best != _cache.size())
+        {
+            dst = _cache[best];
+            _cache.erase(_cache.begin() + best);
+            return true;
+        }
+
+        dst.instance_count = 1;
+        construct_buffer(dst, size);
+        auto alloc_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_TO_CPU, vk::MemoryPropertyFlagBits::eHostVisible,
+                                          vk::MemoryPropertyFlagBits::eHostCached, 0.1f);
+        if (!allocate_buffer(dst, alloc_info, vk::BufferUsageFlagBits::eTransferDst, _device)) return false;
+        if (!map_buffer(dst, _device))
+        {
+            destroy_buffer(dst, _device);
+            return false;
+        }
+        return true;
+    }
+
+    bool readback_queue::push(single_time_exec &exec, buffer &dst, vk::DeviceSize size, readback_callback &&callback)
+    {
+        // Make the transfer writes visible to the host reads that follow the completion of the submission.
+        vk::MemoryBarrier barrier{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead};
+        exec.command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                            {}, 1, &barrier, 0, nullptr, 0, nullptr, exec.loader);
+        pending_readback readback;
+        readback.command_buffer = exec.command_buffer;
+        readback.dst = dst;
+        readback.size = size;
+        readback.callback = std::move(callback);
+        _pending.push_back(std::move(readback));
+        return true;
+    }
+
+    bool readback_queue::read_buffer(single_time_exec &exec, vk::Buffer src, vk::DeviceSize size,
+                                     vk::DeviceSize offset, readback_callback &&callback)
+    {
+        buffer dst;
+        if (!acquire_buffer(size, dst)) return false;
+        vk::BufferCopy region(offset, 0, size);
+        exec.command_buffer.copyBuffer(src, dst.vk_buffer, 1, &region, exec.loader);
+        return push(exec, dst, size, std::move(callback));
+    }
+
+    bool readback_queue::read_image(single_time_exec &exec, const readback_image_info &info,
+                                    readback_callback &&callback)
+    {
+        buffer dst;
+        const vk::DeviceSize size = info.size();
+        if (!acquire_buffer(size, dst)) return false;
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(0)
+            .setBufferRowLength(0)
+            .setBufferImageHeight(0)
+            .setImageSubresource({info.aspect, info.mip_level, info.base_layer, info.layer_count})
+            .setImageOffset(info.offset)
+            .setImageExtent(info.extent);
+        exec.command_buffer.copyImageToBuffer(info.image, info.layout, dst.vk_buffer, 1, &region, exec.loader);
+        return push(exec, dst, size, std::move(callback));
+    }
+
+    exec_ticket readback_queue::submit(single_time_exec &exec)
+    {
+        vk::CommandBuffer command_buffer = exec.command_buffer;
+        exec_ticket ticket = exec.end_async();
+        for (auto &readback : _pending)
+        {
+            if (readback.bound || readback.command_buffer != command_buffer) continue;
+            readback.bound = true;
+            readback.ticket = ticket;
+        }
+        return ticket;
+    }
+
+    void readback_queue::submitted(vk::CommandBuffer command_buffer, const timeline_point &point)
+    {
+        for (auto &readback : _pending)
+        {
+            if (readback.bound || readback.command_buffer != command_buffer) continue;
+            readback.bound = true;
+            readback.point = point;
+        }
+    }
+
+    void readback_queue::deliver(pending_readback &readback, vk::Result result)
+    {
+        bool is_success = result == vk::Result::eSuccess;
+        if (is_success) is_success = invalidate_buffer(readback.dst, _device, readback.size) == vk::Result::eSuccess;
+        if (readback.callback)
+            readback.callback(is_success ? vk::Result::eSuccess : result, is_success ? readback.dst.mapped : nullptr,
+                              readback.size);
+        if (_cache.size() < _max_cached_buffers)
+            _cache.push_back(readback.dst);
+        else
+            destroy_buffer(readback.dst, _device);
+    }
+
+    size_t readback_queue::collect()
+    {
+        // Callbacks may record new readbacks, so the completed ones are moved out before they are delivered.
+        acul::vector<pending_readback> ready;
+        acul::vector<vk::Result> results;
+        size_t last = 0;
+        for (size_t i = 0; i < _pending.size(); ++i)
+        {
+            auto &readback = _pending[i];
+            bool completed = false;
+            vk::Result result = vk::Result::eSuccess;
+            if (readback.ticket.valid())
+            {
+                completed = readback.ticket.ready();
+                result = readback.ticket.result();
+            }
+            else if (readback.point.valid())
+                completed = readback.point.timeline->reached(readback.point.value, _device.vk_device, _device.loader);
+            if (completed)
+            {
+                ready.push_back(std::move(readback));
+                results.push_back(result);
+            }
+            else if (last != i)
+                _pending[last++] = std::move(readback);
+            else
+                ++last;
+        }
+        _pending.resize(last);
+        for (size_t i = 0; i < ready.size(); ++i) deliver(ready[i], results[i]);
+        return ready.size();
+    }
+
+    void readback_queue::flush()
+    {
+        auto pending = std::move(_pending);
+        _pending.clear();
+        bool untracked = false;
+        for (auto &readback : pending)
+            if (readback.bound && !readback.ticket.valid() && !readback.point.valid()) untracked = true;
+        if (untracked) _device.vk_device.waitIdle(_device.loader);
+        for (auto &readback : pending)
+        {
+            vk::Result result = vk::Result::eNotReady;
+            if (readback.ticket.valid())
+                result = readback.ticket.wait();
+            else if (readback.point.valid())
+                result = readback.point.timeline->wait(readback.point.value, _device.vk_device, _device.loader);
+            else if (readback.bound)
+                result = vk::Result::eSuccess;
+            deliver(readback, result);
+        }
+    }
+} // namespace agrb
@@ -0,0 +1,127 @@
+#include <agrb/utils/staging.hpp>
+
+namespace agrb
+{
+    bool staging_ring::create(device &device, vk::DeviceSize capacity)
+    {
+        assert(!valid() && capacity > 0);
+        capacity = get_alignment(capacity, max_alignment);
+        if (!create_staging_buffer(_buffer, capacity, device)) return false;
+        _device = &device;
+        _coherent = static_cast<bool>(get_allocation_memory_flags(device.allocator, _buffer.allocation) &
+                                      vk::MemoryPropertyFlagBits::eHostCoherent);
+        _head = _tail = 0;
+        _stats = {};
+        _stats.capacity = capacity;
+        return true;
+    }
+
+    void staging_ring::destroy()
+    {
+        if (!valid()) return;
+        acul::vector<range_record> ranges;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            ranges = std::move(_ranges);
+            _ranges.clear();
+        }
+        for (auto &range : ranges)
+            if (range.retired) range.ticket.wait();
+        destroy_buffer(_buffer, *_device);
+        _device = nullptr;
+    }
+
+    size_t staging_ring::reclaim()
+    {
+        // Ranges are released strictly in allocation order, a pending range keeps the ones behind it alive.
+        size_t count = 0;
+        while (count < _ranges.size() && _ranges[count].retired && _ranges[count].ticket.ready()) ++count;
+        if (count == 0) return 0;
+        _tail = _ranges[count - 1].end;
+        _ranges.erase(_ranges.begin(), _ranges.begin() + count);
+        if (_ranges.empty()) _head = _tail;
+        return count;
+    }
+
+    bool staging_ring::allocate(vk::DeviceSize size, buffer &out, vk::DeviceSize alignment)
+    {
+        assert(valid() && alignment > 0 && alignment <= max_alignment && (alignment & (alignment - 1)) == 0);
+        const u64 capacity = _stats.capacity;
+        std::unique_lock<std::mutex> lock(_lock);
+        if (size == 0 || size > capacity)
+        {
+            ++_stats.fallbacks;
+            return false;
+        }
+
+        u64 begin, end;
+        bool wrapped, stalled = false;
+        for (;;)
+        {
+            begin = get_alignment(_head, alignment);
+            if (begin % capacity + size > capacity) begin += capacity - begin % capacity;
+            wrapped = begin / capacity != (_head == 0 ? 0 : (_head - 1) / capacity);
+            end = begin + size;
+            if (end - _tail <= capacity) break;
+            if (reclaim() > 0) continue;
+            if (_ranges.empty() || !_ranges.front().retired)
+            {
+                ++_stats.fallbacks;
+                return false;
+            }
+            // Block on a copy of the ticket without the lock, other threads keep allocating and retiring.
+            // The head may move meanwhile, so the range is placed again afterwards.
+            stalled = true;
+            exec_ticket oldest = _ranges.front().ticket;
+            lock.unlock();
+            oldest.wait();
+            lock.lock();
+        }
+
+        _ranges.push_back({end, {}, false});
+        _head = end;
+        ++_stats.allocations;
+        if (stalled) ++_stats.stalls;
+        if (wrapped) ++_stats.wraps;
+        _stats.peak_used = std::max<vk::DeviceSize>(_stats.peak_used, _head - _tail);
+
+        out = {};
+        out.instance_count = 1;
+        out.vk_buffer = _buffer.vk_buffer;
+        out.offset = begin % capacity;
+        out.buffer_size = size;
+        out.alignment_size = size;
+        out.mapped = static_cast<char *>(_buffer.mapped) + out.offset;
+        return true;
+    }
+
+    void staging_ring::write(buffer &range, const void *data, vk::DeviceSize size)
+    {
+        assert(range.vk_buffer == _buffer.vk_buffer && size <= range.buffer_size);
+        memcpy(range.mapped, data, size);
+        if (!_coherent) vmaFlushAllocation(_device->allocator, _buffer.allocation, range.offset, size);
+    }
+
+    void staging_ring::retire(const buffer &range, const exec_ticket &ticket)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        const u64 capacity = _stats.capacity;
+        // Pending ranges are few and the most recent ones are retired first, so search from the back.
+        for (auto it = _ranges.rbegin(); it != _ranges.rend(); ++it)
+        {
+            if (it->retired || (it->end - range.buffer_size) % capacity != range.offset) continue;
+            it->ticket = ticket;
+            it->retired = true;
+            break;
+        }
+        reclaim();
+    }
+
+    staging_ring_stats staging_ring::stats() const
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        staging_ring_stats stats = _stats;
+        stats.used = _head - _tail;
+        return stats;
+    }
+} // namespace agrb
@@ -0,0 +1,88 @@
+#include <agrb/utils/stream.hpp>
+
+namespace agrb
+{
+    bool stream_to_gpu(stream_upload_info &upload_info, device &device)
+    {
+        auto &source = upload_info.source;
+        if (source.size == 0 || !source.read || !upload_info.on_copy_chunk) return false;
+        const vk::DeviceSize chunk_size = std::min(upload_info.chunk_size, source.size);
+        const vk::DeviceSize chunk_count = (source.size + chunk_size - 1) / chunk_size;
+        const u32 slot_count = static_cast<u32>(std::min<vk::DeviceSize>(std::max(upload_info.read_ahead, 1u),
+                                                                         chunk_count));
+
+        auto &queues = device.rd->queues;
+        bool use_transfer_queue = upload_info.on_ownership_transfer && queues.has_dedicated_transfer();
+        auto &queue = use_transfer_queue ? queues.transfer : queues.graphics;
+        queue_ownership ownership{};
+        if (use_transfer_queue) ownership = {queues.transfer.family_id.value(), queues.graphics.family_id.value()};
+
+        struct stream_slot
+        {
+            buffer staging;
+            exec_ticket ticket;
+        };
+        acul::vector<stream_slot> slots(slot_count);
+        auto release_slots = [&]() {
+            for (auto &slot : slots)
+            {
+                slot.ticket.wait();
+                if (slot.staging.vk_buffer) destroy_buffer(slot.staging, device);
+            }
+        };
+        for (auto &slot : slots)
+        {
+            if (create_staging_buffer(slot.staging, chunk_size, device)) continue;
+            release_slots();
+            return false;
+        }
+
+        bool is_success = true;
+        exec_ticket last_ticket;
+        for (vk::DeviceSize chunk = 0; chunk < chunk_count && is_success; ++chunk)
+        {
+            auto &slot = slots[chunk % slot_count];
+            // The slot is refilled only once the GPU has consumed its previous chunk.
+            if (slot.ticket.wait() != vk::Result::eSuccess)
+            {
+                is_success = false;
+                break;
+            }
+            const vk::DeviceSize offset = chunk * chunk_size;
+            const vk::DeviceSize size = std::min(chunk_size, source.size - offset);
+            if (!source.read(slot.staging.mapped, offset, size))
+            {
+                is_success = false;
+                break;
+            }
+            flush_buffer(slot.staging, device, size);
+
+            single_time_exec exec{device, queue};
+            upload_info.on_copy_chunk(exec, slot.staging, offset, size);
+            // Barriers cover every earlier submission of the queue, so releasing after the last chunk is enough.
+            if (use_transfer_queue && chunk + 1 == chunk_count) upload_info.on_ownership_transfer(exec, ownership);
+            slot.ticket = exec.end_async();
+            last_ticket = slot.ticket;
+        }
+
+        if (is_success && (use_transfer_queue || upload_info.on_upload))
+        {
+            single_time_exec exec{device};
+            if (use_transfer_queue)
+            {
+                exec.wait_for(last_ticket, vk::PipelineStageFlagBits::eAllCommands);
+                if (last_ticket.result() != vk::Result::eNotReady && last_ticket.result() != vk::Result::eSuccess)
+                {
+                    exec.end();
+                    release_slots();
+                    return false;
+                }
+                upload_info.on_ownership_transfer(exec, ownership);
+            }
+            if (upload_info.on_upload) upload_info.on_upload(exec);
+            is_success = exec.end() == vk::Result::eSuccess;
+        }
+        release_slots();
+        return is_success && last_ticket.result() == vk::Result::eSuccess;
+    }
+} // namespace agrb
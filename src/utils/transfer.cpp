@@ -0,0 +1,125 @@
+#include <agrb/utils/transfer.hpp>
+
+namespace agrb
+{
+    bool transfer_batch::add(gpu_upload_info &&upload_info)
+    {
+        if (!upload_info.valid()) return false;
+        upload_record entry;
+        if (upload_info.allocation)
+        {
+            auto mem_flags = get_allocation_memory_flags(_device.allocator, upload_info.allocation);
+            if (mem_flags & vk::MemoryPropertyFlagBits::eHostVisible)
+            {
+                if (!copy_data_to_gpu_buffer_host_visible(upload_info, _device.allocator, mem_flags)) return false;
+                entry.host_visible = true;
+            }
+        }
+
+        if (!entry.host_visible)
+        {
+            if (upload_info.staging)
+            {
+                // The payload is written into the caller's staging buffer right away, so a range still read by a
+                // pending upload must not be handed out again.
+                assert(upload_info.on_staging_request);
+                if (overlaps_pending_staging(*upload_info.staging, upload_info.size)) return false;
+                if (!upload_info.on_staging_request(upload_info.data, upload_info.size)) return false;
+            }
+            else
+            {
+                buffer staging;
+                if (!create_staging_buffer(staging, upload_info.size, _device)) return false;
+                write_to_buffer(staging, upload_info.data, upload_info.size);
+                unmap_buffer(staging, _device);
+                entry.staging_id = _staging.size();
+                _staging.push_back(staging);
+            }
+        }
+
+        // The payload has been consumed, the caller may release it now.
+        upload_info.data = nullptr;
+        entry.info = std::move(upload_info);
+        _uploads.push_back(std::move(entry));
+        return true;
+    }
+
+    bool transfer_batch::overlaps_pending_staging(const buffer &staging, vk::DeviceSize size) const
+    {
+        for (auto &upload : _uploads)
+        {
+            if (upload.staging_id != external_staging || !upload.info.staging) continue;
+            const buffer &pending = *upload.info.staging;
+            if (pending.vk_buffer != staging.vk_buffer) continue;
+            if (staging.offset < pending.offset + upload.info.size && pending.offset < staging.offset + size)
+                return true;
+        }
+        return false;
+    }
+
+    buffer &transfer_batch::staging_of(upload_record &upload)
+    {
+        return upload.staging_id == external_staging ? *upload.info.staging : _staging[upload.staging_id];
+    }
+
+    acul::vector<buffer> transfer_batch::record(single_time_exec &exec, const queue_ownership *ownership)
+    {
+        for (auto &upload : _uploads)
+        {
+            if (upload.host_visible) continue;
+            if (upload.transferred)
+                upload.info.on_ownership_transfer(exec, *ownership);
+            else if (upload.info.on_copy_staging)
+                upload.info.on_copy_staging(exec, staging_of(upload));
+        }
+
+        for (auto &upload : _uploads)
+            if (upload.info.on_upload) upload.info.on_upload(exec, !upload.host_visible);
+
+        _uploads.clear();
+        acul::vector<buffer> staging = std::move(_staging);
+        _staging.clear();
+        return staging;
+    }
+
+    exec_ticket transfer_batch::submit()
+    {
+        if (_uploads.empty()) return {};
+        auto &queues = _device.rd->queues;
+        queue_ownership ownership{};
+        exec_ticket transfer_ticket;
+        bool use_transfer_queue = false;
+        if (queues.has_dedicated_transfer())
+        {
+            ownership = {queues.transfer.family_id.value(), queues.graphics.family_id.value()};
+            use_transfer_queue = std::any_of(_uploads.begin(), _uploads.end(), [](const upload_record &upload) {
+                return !upload.host_visible && upload.info.on_ownership_transfer;
+            });
+        }
+
+        if (use_transfer_queue)
+        {
+            // Staging copies run on the transfer queue and are released to the graphics queue.
+            single_time_exec transfer_exec{_device, queues.transfer};
+            for (auto &upload : _uploads)
+            {
+                if (upload.host_visible || !upload.info.on_ownership_transfer) continue;
+                if (upload.info.on_copy_staging) upload.info.on_copy_staging(transfer_exec, staging_of(upload));
+                upload.info.on_ownership_transfer(transfer_exec, ownership);
+                upload.transferred = true;
+            }
+            transfer_ticket = transfer_exec.end_async();
+        }
+
+        single_time_exec exec{_device};
+        if (use_transfer_queue) exec.wait_for(transfer_ticket, vk::PipelineStageFlagBits::eAllCommands);
+        auto staging = record(exec, use_transfer_queue ? &ownership : nullptr);
+        exec_ticket ticket = exec.end_async();
+        // The graphics submission waits for the transfer one, so both complete together.
+        ticket.then([staging = std::move(staging), transfer_ticket, &device = _device](vk::Result) mutable {
+            transfer_ticket.ready();
+            release_staging(staging, device);
+        });
+        return ticket;
+    }
+} // namespace agrb
@@ -1,4 +1,12 @@
+#include <agrb/aliasing.hpp>
+#include <agrb/buffer_arena.hpp>
+#include <agrb/defrag.hpp>
+#include <agrb/frame_allocator.hpp>
+#include <agrb/memory_budget.hpp>
+#include <agrb/retire.hpp>
 #include <agrb/utils/buffer.hpp>
+#include <agrb/utils/readback.hpp>
+#include <agrb/utils/staging.hpp>
 #include "env.hpp"
 
 using namespace agrb;
@@ -81,6 +89,484 @@ void check_move_to_buffer(device &d)
     assert(b.vk_buffer == VK_NULL_HANDLE);
 }
 
+void check_retire_queue(device &d)
+{
+    retire_queue queue{d};
+    buffer src, dst;
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, 0.5f);
+    for (buffer *b : {&src, &dst})
+    {
+        b->instance_count = 1;
+        construct_buffer(*b, 256);
+        assert(allocate_buffer(*b, create_info,
+                               vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst, d));
+    }
+
+    single_time_exec exec{d};
+    copy_buffer(exec, d, src.vk_buffer, dst.vk_buffer, 256);
+    exec_ticket ticket = exec.end_async();
+
+    // Both buffers are still used by the submission
+    retire_buffer(src, d, queue, ticket.point());
+    retire_buffer(dst, d, queue, ticket.point());
+    assert(!src.vk_buffer && !dst.vk_buffer);
+    assert(queue.size() == 2);
+
+    assert(ticket.wait() == vk::Result::eSuccess);
+    if (ticket.point().valid())
+        assert(queue.collect() == 2);
+    else
+        queue.flush();
+    assert(queue.size() == 0);
+}
+
+void check_staging_ring(device &d)
+{
+    staging_ring ring;
+    assert(ring.create(d, 1000));
+    assert(ring.stats().capacity == 1024);
+
+    buffer dst;
+    dst.instance_count = 1;
+    construct_buffer(dst, 512);
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, 0.5f);
+    assert(allocate_buffer(dst, create_info, vk::BufferUsageFlagBits::eTransferDst, d));
+
+    // Sub-allocation and wrap-around
+    buffer first, second, third;
+    assert(ring.allocate(500, first) && first.offset == 0);
+    assert(ring.allocate(500, second) && second.offset == 512);
+    assert(!ring.allocate(100, third)); // Both ranges are still pending
+    single_time_exec exec{d};
+    copy_buffer(exec, d, first.vk_buffer, dst.vk_buffer, 500, first.offset);
+    exec_ticket ticket = exec.end_async();
+    ring.retire(first, ticket);
+    ring.retire(second, {});
+    assert(ring.allocate(400, third) && third.offset == 0);
+    auto stats = ring.stats();
+    assert(stats.wraps == 1 && stats.fallbacks == 1 && stats.allocations == 3 && stats.used == 412);
+    ring.retire(third, {});
+    assert(ring.stats().used == 0 && ring.stats().peak_used == 1012);
+    assert(!ring.allocate(2048, third));
+
+    // Upload functions use the ring transparently
+    d.rd->staging = &ring;
+    int payload[128] = {};
+    gpu_upload_info upload_info;
+    upload_info.allocation = dst.allocation;
+    upload_info.data = payload;
+    upload_info.size = sizeof(payload);
+    upload_info.on_copy_staging = make_copy_buffer_callback(d, dst, sizeof(payload));
+    assert(copy_data_to_gpu_buffer_staging(upload_info, d));
+    ring.collect();
+    assert(ring.stats().allocations == 4 && ring.stats().used == 0);
+    d.rd->staging = nullptr;
+
+    destroy_buffer(dst, d);
+    ring.destroy();
+    assert(!ring.valid());
+}
+
+void check_buffer_arena(device &d)
+{
+    buffer_arena arena;
+    arena.create(d, buffer_arena_create_info{}
+                        .set_block_size(4096)
+                        .set_usage(vk::BufferUsageFlagBits::eUniformBuffer)
+                        .set_alloc_info(make_alloc_info(VMA_MEMORY_USAGE_CPU_TO_GPU,
+                                                        vk::MemoryPropertyFlagBits::eHostVisible))
+                        .set_mapped(true));
+
+    buffer ranges[4];
+    for (auto &range : ranges) assert(arena.allocate(100, range));
+    assert(arena.stats().blocks == 1 && arena.stats().allocations == 4 && arena.stats().used_bytes == 400);
+    for (size_t i = 1; i < 4; ++i)
+    {
+        assert(ranges[i].vk_buffer == ranges[0].vk_buffer && ranges[i].offset % arena.alignment() == 0);
+        assert(ranges[i].offset >= ranges[i - 1].offset + 100 || ranges[i].offset + 100 <= ranges[i - 1].offset);
+    }
+
+    int value = 42;
+    write_to_buffer(ranges[2], &value, sizeof(int));
+    assert(flush_buffer(ranges[2], d) == vk::Result::eSuccess);
+    assert(*static_cast<int *>(ranges[2].mapped) == 42);
+    auto info = get_descriptor_info(ranges[2]);
+    assert(info.offset == ranges[2].offset && info.range == 100);
+    // The first range of a block starts at offset 0 and must not cover the rest of the block
+    assert(ranges[0].offset == 0 && get_descriptor_info(ranges[0]).range == 100);
+    for (auto &range : ranges)
+    {
+        auto range_info = get_descriptor_info(range);
+        assert(range_info.offset == range.offset && range_info.range == 100);
+    }
+
+    // Oversized requests get a dedicated block that goes away with its last range
+    buffer large;
+    assert(arena.allocate(8192, large) && large.vk_buffer != ranges[0].vk_buffer);
+    assert(arena.stats().blocks == 2);
+    arena.release(large);
+    assert(arena.stats().blocks == 1 && !large.vk_buffer);
+
+    for (auto &range : ranges) arena.release(range);
+    assert(arena.stats().allocations == 0 && arena.stats().used_bytes == 0);
+    arena.destroy();
+}
+
+void check_arena_upload(device &d)
+{
+    const vk::DeviceSize size = 64 * sizeof(u32);
+    u32 first_payload[64], second_payload[64];
+    for (u32 i = 0; i < 64; ++i)
+    {
+        first_payload[i] = i;
+        second_payload[i] = 1000 + i;
+    }
+
+    // Staged uploads copy into the range of the shared vk::Buffer, not to its start
+    buffer_arena arena;
+    arena.create(d, buffer_arena_create_info{}
+                        .set_block_size(4096)
+                        .set_usage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc)
+                        .set_alloc_info(make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {},
+                                                        vk::MemoryPropertyFlagBits::eDeviceLocal)));
+    buffer ranges[2];
+    for (auto &range : ranges) assert(arena.allocate(size, range));
+    assert(ranges[0].vk_buffer == ranges[1].vk_buffer && ranges[1].offset > 0);
+    u32 *payloads[2] = {first_payload, second_payload};
+    for (int i = 0; i < 2; ++i)
+    {
+        gpu_upload_info upload_info;
+        upload_info.allocation = ranges[i].allocation;
+        upload_info.offset = ranges[i].offset;
+        upload_info.size = size;
+        upload_info.data = payloads[i];
+        upload_info.on_copy_staging = make_copy_buffer_callback(d, ranges[i], size);
+        upload_info.on_ownership_transfer = make_buffer_ownership_callback(ranges[i]);
+        assert(copy_data_to_gpu_buffer(upload_info, d));
+    }
+
+    readback_queue readbacks{d};
+    single_time_exec exec{d};
+    auto first = readbacks.read_buffer(exec, ranges[0].vk_buffer, size, ranges[0].offset);
+    auto second = readbacks.read_buffer(exec, ranges[1].vk_buffer, size, ranges[1].offset);
+    readbacks.submit(exec);
+    readbacks.flush();
+    auto first_data = first.get(), second_data = second.get();
+    assert(first_data.result == vk::Result::eSuccess && second_data.result == vk::Result::eSuccess);
+    assert(memcmp(first_data.data.data(), first_payload, size) == 0);
+    assert(memcmp(second_data.data.data(), second_payload, size) == 0);
+    for (auto &range : ranges) arena.release(range);
+    arena.destroy();
+
+    // Host visible ranges are written at their offset inside the block
+    buffer_arena mapped_arena;
+    mapped_arena.create(d, buffer_arena_create_info{}
+                               .set_block_size(4096)
+                               .set_usage(vk::BufferUsageFlagBits::eStorageBuffer)
+                               .set_alloc_info(make_alloc_info(VMA_MEMORY_USAGE_CPU_TO_GPU,
+                                                               vk::MemoryPropertyFlagBits::eHostVisible))
+                               .set_mapped(true));
+    for (auto &range : ranges) assert(mapped_arena.allocate(size, range));
+    for (int i = 0; i < 2; ++i)
+    {
+        gpu_upload_info upload_info;
+        upload_info.allocation = ranges[i].allocation;
+        upload_info.offset = ranges[i].offset;
+        upload_info.size = size;
+        upload_info.data = payloads[i];
+        assert(copy_data_to_gpu_buffer(upload_info, d));
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        assert(invalidate_buffer(ranges[i], d) == vk::Result::eSuccess);
+        assert(memcmp(ranges[i].mapped, payloads[i], size) == 0);
+    }
+    for (auto &range : ranges) mapped_arena.release(range);
+    mapped_arena.destroy();
+}
+
+void check_frame_allocator(device &d)
+{
+    frame_allocator allocator;
+    assert(allocator.create(d, 1000, 2));
+    const auto capacity = allocator.stats().frame_capacity;
+    assert(capacity >= 1000);
+
+    buffer first, second, vertices;
+    f32 constants[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+    assert(allocator.push(constants, sizeof(constants), 16, first) && first.offset == 0);
+    assert(get_descriptor_info(first).range == sizeof(constants));
+    assert(allocator.allocate_uniform(64, second));
+    assert(second.offset % d.rd->properties2.properties.limits.minUniformBufferOffsetAlignment == 0);
+    assert(allocator.allocate_vertices(10, vertices) && vertices.offset >= second.offset + 64);
+    assert(static_cast<f32 *>(first.mapped)[2] == 3.0f);
+    assert(allocator.flush() == vk::Result::eSuccess);
+
+    buffer overflow;
+    assert(!allocator.allocate(capacity, 16, overflow));
+    assert(allocator.stats().overflows == 1);
+
+    // The second frame uses its own region, and frame 0 starts over once it comes back
+    allocator.reset(1);
+    assert(allocator.allocate_uniform(64, second) && second.offset == capacity);
+    allocator.reset(0);
+    assert(allocator.stats().used == 0 && allocator.stats().peak_used >= 74);
+    assert(allocator.allocate_uniform(64, second) && second.offset == 0);
+    allocator.destroy();
+}
+
+void check_memory_budget(device &d)
+{
+    acul::vector<heap_budget> budgets;
+    get_heap_budgets(d, budgets);
+    assert(!budgets.empty());
+    for (auto &heap : budgets) assert(heap.budget > 0 && heap.allocation_bytes <= heap.block_bytes);
+
+    // A zero threshold reports pressure on every allocation, which must still succeed
+    u32 pressure_calls = 0;
+    memory_budget_policy policy;
+    policy.set_threshold(0.0f).set_on_pressure([&](u32 heap, const heap_budget &snapshot, vk::DeviceSize size) {
+        assert(heap < budgets.size() && size == 1024);
+        ++pressure_calls;
+    });
+    d.rd->budget_policy = &policy;
+    buffer b;
+    b.instance_count = 1;
+    construct_buffer(b, 1024);
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, 0.5f);
+    assert(allocate_buffer(b, create_info, vk::BufferUsageFlagBits::eTransferDst, d));
+    assert(pressure_calls == 1);
+    d.rd->budget_policy = nullptr;
+    destroy_buffer(b, d);
+}
+
+void check_defragmenter(device &d)
+{
+    const vk::DeviceSize size = 64 * 1024;
+    const auto usage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, 0.5f);
+    buffer buffers[16];
+    for (auto &b : buffers)
+    {
+        b.instance_count = 1;
+        construct_buffer(b, size);
+        assert(allocate_buffer(b, create_info, usage, d));
+    }
+    // Leave holes between the surviving buffers
+    for (size_t i = 0; i < 16; i += 2) destroy_buffer(buffers[i], d);
+
+    defragmenter defrag{d};
+    u32 moved = 0;
+    {
+        single_time_exec exec{d};
+        for (size_t i = 1; i < 16; i += 2)
+        {
+            exec.command_buffer.fillBuffer(buffers[i].vk_buffer, 0, size, static_cast<u32>(i), d.loader);
+            defrag.track(buffers[i], usage, [&moved](buffer &) { ++moved; });
+        }
+        assert(exec.end() == vk::Result::eSuccess);
+    }
+    defrag.run();
+    assert(!defrag.running() && !defrag.pass_pending());
+    assert(defrag.stats().moved_allocations == moved);
+
+    // Contents survive the moves
+    buffer readback;
+    assert(create_staging_buffer(readback, sizeof(u32), d));
+    for (size_t i = 1; i < 16; i += 2)
+    {
+        copy_buffer(d, buffers[i].vk_buffer, readback.vk_buffer, sizeof(u32));
+        assert(*static_cast<u32 *>(readback.mapped) == i);
+        defrag.untrack(buffers[i].allocation);
+        destroy_buffer(buffers[i], d);
+    }
+    destroy_buffer(readback, d);
+}
+
+void check_direct_write(device &d)
+{
+    buffer b;
+    b.instance_count = 1;
+    construct_buffer(b, sizeof(u32) * 4);
+    auto alloc_info = make_direct_write_alloc_info(*d.rd);
+    assert(allocate_buffer(b, alloc_info, vk::BufferUsageFlagBits::eStorageBuffer, d));
+    auto mem_flags = get_allocation_memory_flags(d.allocator, b.allocation);
+    if (d.rd->direct_write_memory_types()) assert(mem_flags & vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    u32 values[4] = {1, 2, 3, 4};
+    gpu_upload_info upload_info;
+    upload_info.allocation = b.allocation;
+    upload_info.data = values;
+    upload_info.size = sizeof(values);
+    upload_info.on_copy_staging = make_copy_buffer_callback(d, b, sizeof(values));
+    assert(copy_data_to_gpu_buffer(upload_info, d));
+    if (mem_flags & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        assert(map_buffer(b, d));
+        assert(invalidate_buffer(b, d) == vk::Result::eSuccess);
+        assert(static_cast<u32 *>(b.mapped)[3] == 4);
+    }
+    destroy_buffer(b, d);
+}
+
+void check_dirty_ranges(device &d)
+{
+    dirty_range_tracker tracker;
+    tracker.atom_size = 64;
+    tracker.coherent = false;
+    for (vk::DeviceSize offset : {0, 10, 70, 130, 200}) tracker.mark(offset, 8);
+    tracker.merge(1024);
+    assert(tracker.ranges.size() == 1 && tracker.ranges[0].begin == 0 && tracker.ranges[0].end == 256);
+    tracker.ranges.clear();
+    tracker.mark(0, 1);
+    tracker.mark(300, 1);
+    tracker.merge(1024);
+    assert(tracker.ranges.size() == 2);
+    // Aligned ends never pass the end of a range that is not a multiple of the atom size
+    tracker.ranges.clear();
+    tracker.mark(90, 8);
+    tracker.merge(100);
+    assert(tracker.ranges.size() == 1 && tracker.ranges[0].begin == 64 && tracker.ranges[0].end == 100);
+
+    buffer b;
+    b.instance_count = 4;
+    construct_buffer(b, 256);
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_CPU_TO_GPU, vk::MemoryPropertyFlagBits::eHostVisible);
+    assert(allocate_buffer(b, create_info, vk::BufferUsageFlagBits::eUniformBuffer, d));
+    assert(map_buffer(b, d));
+    track_dirty_ranges(b, d);
+    int value = 5;
+    for (int i = 0; i < 4; ++i) write_to_buffer_index(b, sizeof(int), &value, i);
+    assert(b.dirty_ranges->coherent == b.dirty_ranges->empty());
+    assert(flush_dirty_ranges(d, b) == vk::Result::eSuccess && b.dirty_ranges->empty());
+    destroy_buffer(b, d);
+    assert(!b.dirty_ranges);
+
+    // Flushed ranges of a buffer whose size is not a multiple of the atom size stay inside the allocation
+    buffer odd;
+    odd.instance_count = 1;
+    construct_buffer(odd, 100);
+    assert(allocate_buffer(odd, create_info, vk::BufferUsageFlagBits::eUniformBuffer, d));
+    assert(map_buffer(odd, d));
+    track_dirty_ranges(odd, d);
+    odd.dirty_ranges->coherent = false;
+    write_to_buffer(odd, &value, sizeof(int), 96);
+    assert(!odd.dirty_ranges->empty());
+    assert(flush_dirty_ranges(d, odd) == vk::Result::eSuccess && odd.dirty_ranges->empty());
+    destroy_buffer(odd, d);
+}
+
+void check_device_address(device &d)
+{
+    const auto usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    buffer b;
+    b.instance_count = 1;
+    construct_buffer(b, 1024);
+    if (!d.rd->features.buffer_device_address)
+    {
+        assert(!allocate_buffer(b, create_info, usage, d));
+        return;
+    }
+    assert(allocate_buffer(b, create_info, usage, d));
+    assert(b.device_address() != 0);
+    destroy_buffer(b, d);
+    assert(b.device_address() == 0);
+
+    buffer_arena arena;
+    arena.create(d, buffer_arena_create_info{}.set_block_size(4096).set_usage(usage).set_alloc_info(create_info));
+    buffer first, second;
+    assert(arena.allocate(256, first) && arena.allocate(256, second));
+    assert(first.vk_buffer == second.vk_buffer);
+    assert(second.device_address() - first.device_address() == second.offset - first.offset);
+    arena.release(first);
+    arena.release(second);
+    arena.destroy();
+}
+
+void check_aliasing(device &d)
+{
+    aliasing_allocator allocator{d};
+    const auto usage = vk::BufferUsageFlagBits::eStorageBuffer;
+    buffer first, second, shared;
+    allocator.declare(first, 64 * 1024, usage, {0, 0});
+    allocator.declare(second, 64 * 1024, usage, {1, 1});
+    allocator.declare(shared, 32 * 1024, usage, {0, 1});
+
+    vk::ImageCreateInfo image_info{};
+    image_info.setImageType(vk::ImageType::e2D)
+        .setExtent({64, 64, 1})
+        .setMipLevels(1)
+        .setArrayLayers(1)
+        .setFormat(vk::Format::eR8G8B8A8Unorm)
+        .setTiling(vk::ImageTiling::eOptimal)
+        .setInitialLayout(vk::ImageLayout::eUndefined)
+        .setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled)
+        .setSharingMode(vk::SharingMode::eExclusive)
+        .setSamples(vk::SampleCountFlagBits::e1);
+    fb_image attachment{};
+    allocator.declare(attachment, image_info, {2, 2});
+
+    assert(allocator.build());
+    assert(first.vk_buffer && second.vk_buffer && shared.vk_buffer && attachment.image);
+    assert(allocator.stats().resources == 4);
+    assert(allocator.stats().allocated_bytes < allocator.stats().requested_bytes);
+
+    for (buffer *b : {&first, &second, &shared}) destroy_buffer(*b, d);
+    destroy_fb_image(attachment, d);
+    allocator.release();
+    assert(allocator.stats().blocks == 0);
+
+    if (!d.rd->features.buffer_device_address)
+    {
+        buffer addressed;
+        allocator.declare(addressed, 1024, usage | vk::BufferUsageFlagBits::eShaderDeviceAddress, {0, 0});
+        assert(!allocator.build() && !addressed.vk_buffer);
+        allocator.release();
+    }
+}
+
+void check_transfer_queue(device &d)
+{
+    auto &queues = d.rd->queues;
+    if (!queues.has_dedicated_transfer()) return;
+    auto flags = d.physical_device.getQueueFamilyProperties(d.loader)[queues.transfer.family_id.value()].queueFlags;
+    assert(!(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)));
+
+    u32 payload[256];
+    for (u32 i = 0; i < 256; ++i) payload[i] = i * 3;
+    buffer dst;
+    dst.instance_count = 1;
+    construct_buffer(dst, sizeof(payload));
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    assert(allocate_buffer(dst, create_info,
+                           vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc, d));
+
+    // Copy on the transfer queue, release to the graphics queue, acquire there
+    bool acquired = false;
+    gpu_upload_info upload_info;
+    upload_info.allocation = dst.allocation;
+    upload_info.size = sizeof(payload);
+    upload_info.data = payload;
+    upload_info.on_copy_staging = make_copy_buffer_callback(d, dst, sizeof(payload));
+    upload_info.on_ownership_transfer = [&](single_time_exec &exec, const queue_ownership &ownership) {
+        assert(ownership.src_family == queues.transfer.family_id.value());
+        assert(ownership.dst_family == queues.graphics.family_id.value());
+        if (!exec.is_releasing(ownership)) acquired = true;
+        buffer_ownership_barrier(exec, ownership, dst.vk_buffer);
+    };
+    assert(copy_data_to_gpu_buffer_staging(upload_info, d) && acquired);
+
+    readback_queue readbacks{d};
+    single_time_exec exec{d};
+    auto result = readbacks.read_buffer(exec, dst.vk_buffer, sizeof(payload));
+    readbacks.submit(exec);
+    readbacks.flush();
+    auto data = result.get();
+    assert(data.result == vk::Result::eSuccess && memcmp(data.data.data(), payload, sizeof(payload)) == 0);
+    destroy_buffer(dst, d);
+}
+
 void test_buffer()
 {
     init_library();
@@ -89,6 +575,24 @@ void test_buffer()
     check_buffer_construct(env.d);
     check_buffer_ubo(env.d);
     check_move_to_buffer(env.d);
+    check_retire_queue(env.d);
+    check_staging_ring(env.d);
+    check_buffer_arena(env.d);
+    check_arena_upload(env.d);
+    check_frame_allocator(env.d);
+    check_memory_budget(env.d);
+    check_defragmenter(env.d);
+    check_direct_write(env.d);
+    check_dirty_ranges(env.d);
+    check_device_address(env.d);
+    check_aliasing(env.d);
+    check_transfer_queue(env.d);
     destroy_device(env.d);
+
+    // Buffer device address is opt-in, only this device enables it
+    Enviroment bda_env;
+    init_environment(bda_env, true);
+    check_device_address(bda_env.d);
+    destroy_device(bda_env.d);
     destroy_library();
 }
\ No newline at end of file
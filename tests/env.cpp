@@ -2,12 +2,13 @@
 
 using namespace agrb;
 
-void init_environment(Enviroment &env)
+void init_environment(Enviroment &env, bool buffer_device_address)
 {
     device_create_ctx ctx;
     ctx.set_device_extensions_optional(
            {vk::EXTMemoryPriorityExtensionName, vk::EXTPageableDeviceLocalMemoryExtensionName})
         .set_fence_pool_size(8)
+        .set_buffer_device_address(buffer_device_address)
         .set_runtime_data(&env.rd);
     init_device("app_test", 1, env.d, &ctx);
     assert(env.d.vk_device);
@@ -8,4 +8,4 @@ struct Enviroment
     agrb::device_runtime_data rd;
 };
 
-void init_environment(Enviroment& env);
\ No newline at end of file
+void init_environment(Enviroment& env, bool buffer_device_address = false);
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <agrb/buffer.hpp>
+#include <agrb/frame.hpp>
+#include "env.hpp"
+
+using namespace agrb;
+
+void test_frame()
+{
+    init_library();
+    Enviroment env;
+    init_environment(env);
+
+    const u32 frames_in_flight = 3, frame_count = 8;
+    buffer b;
+    b.instance_count = frames_in_flight;
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_CPU_ONLY, vk::MemoryPropertyFlagBits::eHostVisible,
+                                       vk::MemoryPropertyFlagBits::eHostCoherent, 0.1f);
+    construct_buffer(b, sizeof(u32));
+    assert(allocate_buffer(b, create_info, vk::BufferUsageFlagBits::eTransferDst, env.d));
+    assert(map_buffer(b, env.d));
+
+    frame_controller frames;
+    frames.create(env.d, frames_in_flight);
+    assert(frames.frames_in_flight() == frames_in_flight);
+
+    acul::vector<u32> begun;
+    frames.on_frame_begin([&begun](u32 index) { begun.push_back(index); });
+
+    // Off-screen frames need no swapchain: slots rotate and every submission signals the graphics timeline
+    auto &timeline = env.rd.queues.graphics.timeline;
+    u64 last_submitted = 0;
+    for (u32 i = 0; i < frame_count; ++i)
+    {
+        assert(frames.begin_offscreen_frame() == vk::Result::eSuccess);
+        const u32 index = frames.frame_index();
+        assert(index == i % frames_in_flight);
+        assert(frames.frame_number() == i + 1);
+        assert(begun.size() == i + 1 && begun.back() == index);
+
+        // Once the slot is reused, its previous submission has completed
+        auto &submitted = frames.current().submitted;
+        if (i >= frames_in_flight && timeline.valid())
+        {
+            assert(submitted.valid() && submitted.value > last_submitted);
+            assert(timeline.reached(submitted.value, env.d.vk_device, env.d.loader));
+            last_submitted = submitted.value;
+        }
+
+        frames.command_buffer().fillBuffer(b.vk_buffer, index * b.alignment_size, sizeof(u32), i, env.d.loader);
+        assert(frames.end_offscreen_frame() == vk::Result::eSuccess);
+        assert(frames.frame_index() == (i + 1) % frames_in_flight);
+    }
+    frames.destroy();
+
+    // Each slot holds the value written by the last frame recorded in it
+    for (u32 i = frame_count - frames_in_flight; i < frame_count; ++i)
+    {
+        u32 value;
+        memcpy(&value, static_cast<char *>(b.mapped) + (i % frames_in_flight) * b.alignment_size, sizeof(u32));
+        assert(value == i);
+    }
+
+    unmap_buffer(b, env.d);
+    destroy_buffer(b, env.d);
+    destroy_library();
+}
@@ -0,0 +1,123 @@
+#include <agrb/concurrent_pool.hpp>
+#include <agrb/pool.hpp>
+#include <cassert>
+#include <thread>
+
+using namespace agrb;
+
+struct counting_alloc
+{
+    u64 next = 100;
+    size_t released = 0;
+
+    void alloc(u64 *pData, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) pData[i] = next++;
+    }
+
+    void release(u64 &) { ++released; }
+};
+
+struct atomic_counting_alloc
+{
+    std::atomic<u64> next{100};
+    std::atomic<size_t> released{0};
+
+    void alloc(u64 *pData, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) pData[i] = next++;
+    }
+
+    void release(u64 &) { ++released; }
+};
+
+void check_concurrent_pool()
+{
+    using pool_t = concurrent_resource_pool<u64, atomic_counting_alloc>;
+    pool_t pool;
+    pool.allocate(8);
+    assert(pool.capacity() == 8 && pool.size() == 8);
+
+    // Every thread keeps a few resources at a time; values must never be handed out twice.
+    const int thread_count = 8, iterations = 2000, held = 4;
+    std::atomic<u32> in_use[4096] = {};
+    std::atomic<bool> duplicate{false};
+    acul::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+        threads.emplace_back([&]() {
+            u64 values[held];
+            pool_t::handle handles[held];
+            for (int i = 0; i < iterations; ++i)
+            {
+                pool.request(values, held, handles);
+                for (auto &value : values)
+                    if (value - 100 >= 4096 || in_use[value - 100].exchange(1) != 0) duplicate = true;
+                for (auto &value : values)
+                    if (value - 100 < 4096) in_use[value - 100] = 0;
+                if (i % 2)
+                    pool.release(handles, held);
+                else
+                    for (auto id : handles) pool.release(id);
+            }
+        });
+    for (auto &thread : threads) thread.join();
+    assert(!duplicate);
+    assert(pool.size() == pool.capacity());
+
+    size_t capacity = pool.capacity();
+    pool.destroy();
+    assert(pool.allocator.released == capacity && pool.capacity() == 0);
+}
+
+void test_pool()
+{
+    using pool_t = resource_pool<u64, counting_alloc>;
+    pool_t pool;
+    pool.allocate(4);
+    assert(pool.size() == 4 && pool.capacity() == 4);
+
+    // Preallocated resources are handed out in allocation order
+    u64 values[6];
+    pool_t::handle handles[6];
+    pool.request(values, 3, handles);
+    for (u32 i = 0; i < 3; ++i) assert(values[i] == 100 + i && pool.get(handles[i]) == values[i]);
+    assert(pool.size() == 1);
+
+    // Growing past the free slots allocates new resources
+    pool.request(values + 3, 3, handles + 3);
+    assert(pool.capacity() == 6 && pool.size() == 0);
+    assert(values[3] == 103 && values[4] == 104 && values[5] == 105);
+
+    // Released handles are reused before the pool grows again, last released first
+    pool.release(handles[1]);
+    pool.release(handles + 4, 2);
+    assert(pool.size() == 3);
+    u64 reused[3];
+    pool.request(reused, 3);
+    assert(reused[0] == values[5] && reused[1] == values[4] && reused[2] == values[1]);
+    assert(pool.capacity() == 6);
+
+    // Release by value
+    pool.release(values[0]);
+    assert(pool.size() == 1);
+
+    // High-water mark and shrinking: only idle slots at the end can go
+    assert(pool.stats().capacity == 6 && pool.stats().in_use == 5 && pool.stats().high_water == 6);
+    pool.release(reused, 3);
+    for (u32 i = 2; i < 4; ++i) pool.release(values[i]);
+    assert(pool.stats().in_use == 0);
+    assert(pool.shrink(pool_shrink_policy{}.set_headroom(0.5f)) == 3);
+    assert(pool.capacity() == 3 && pool.stats().high_water == 0 && pool.allocator.released == 3);
+    assert(pool.shrink(pool_shrink_policy{}.set_min_capacity(2)) == 1);
+    assert(pool.capacity() == 2 && pool.size() == 2);
+
+    pool.reset();
+    assert(pool.size() == pool.capacity());
+    pool.request(values, 1);
+    assert(values[0] == 100);
+
+    pool.destroy();
+    assert(pool.allocator.released == 6 && pool.capacity() == 0);
+
+    check_concurrent_pool();
+}
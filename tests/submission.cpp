@@ -0,0 +1,61 @@
+#include <agrb/submission.hpp>
+#include "env.hpp"
+
+using namespace agrb;
+
+void test_submission()
+{
+    init_library();
+    Enviroment env;
+    init_environment(env);
+
+    const int producers = 4, uploads_per_producer = 8;
+    const vk::DeviceSize size = sizeof(u32) * 64;
+    auto create_info = make_alloc_info(VMA_MEMORY_USAGE_GPU_ONLY, {}, vk::MemoryPropertyFlagBits::eDeviceLocal, 0.5f);
+    acul::vector<buffer> buffers(producers * uploads_per_producer);
+    for (auto &b : buffers)
+    {
+        b.instance_count = 1;
+        construct_buffer(b, size);
+        assert(allocate_buffer(b, create_info, vk::BufferUsageFlagBits::eTransferDst, env.d));
+    }
+
+    submission_service service{env.d};
+    service.start();
+    assert(service.running());
+
+    std::atomic<int> completed{0};
+    acul::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p]() {
+            u32 data[64];
+            for (int i = 0; i < uploads_per_producer; ++i)
+            {
+                auto &dst = buffers[p * uploads_per_producer + i];
+                for (u32 &value : data) value = p * uploads_per_producer + i;
+                gpu_upload_info upload_info;
+                upload_info.allocation = dst.allocation;
+                upload_info.size = size;
+                upload_info.data = data;
+                upload_info.on_copy_staging = make_copy_buffer_callback(env.d, dst, size);
+                auto future = service.upload(std::move(upload_info), [&completed](vk::Result res) {
+                    if (res == vk::Result::eSuccess) ++completed;
+                });
+                assert(future.get() == vk::Result::eSuccess);
+            }
+        });
+    for (auto &thread : threads) thread.join();
+
+    // Plain job
+    bool recorded = false;
+    submit_job job;
+    job.record = [&recorded](single_time_exec &) { recorded = true; };
+    assert(service.submit(std::move(job)).get() == vk::Result::eSuccess && recorded);
+
+    service.stop();
+    assert(!service.running());
+    assert(completed == producers * uploads_per_producer);
+
+    for (auto &b : buffers) destroy_buffer(b, env.d);
+    destroy_library();
+}
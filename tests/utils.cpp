@@ -1,5 +1,12 @@
+#include <agrb/command_pool.hpp>
+#include <agrb/fence_tracker.hpp>
+#include <agrb/submit_batch.hpp>
 #include <agrb/utils/buffer.hpp>
+#include <agrb/utils/compute.hpp>
 #include <agrb/utils/image.hpp>
+#include <agrb/utils/readback.hpp>
+#include <agrb/utils/stream.hpp>
+#include <agrb/utils/transfer.hpp>
 #include "env.hpp"
 
 using namespace agrb;
@@ -26,6 +33,274 @@ void test_utils()
     // copy_buffer
     copy_buffer(env.d, src.vk_buffer, dst.vk_buffer, image_size);
 
+    // Async copy
+    {
+        single_time_exec exec{env.d};
+        copy_buffer(exec, env.d, src.vk_buffer, dst.vk_buffer, image_size);
+        exec_ticket ticket = exec.end_async();
+        assert(ticket.valid());
+        bool completed = false;
+        ticket.then([&completed](vk::Result res) { completed = res == vk::Result::eSuccess; });
+        assert(ticket.wait() == vk::Result::eSuccess);
+        assert(ticket.ready() && completed);
+    }
+
+    // Parallel secondary recording
+    {
+        command_pool_registry registry;
+        registry.create(env.d, env.rd.queues.graphics, 4, 2, 0, 2);
+        acul::vector<secondary_record_task> tasks;
+        const vk::DeviceSize chunk = image_size / 8;
+        for (vk::DeviceSize offset = 0; offset < image_size; offset += chunk)
+            tasks.push_back([&dst, offset, chunk, &env](vk::CommandBuffer cmd) {
+                cmd.fillBuffer(dst.vk_buffer, offset, chunk, 0xFFFFFFFF, env.d.loader);
+            });
+        vk::CommandBufferInheritanceInfo inheritance;
+        // The recording threads are started once and reused by every frame
+        for (u32 frame = 0; frame < 2; ++frame)
+        {
+            single_time_exec exec{env.d};
+            record_secondary_parallel(registry, frame, exec.command_buffer, inheritance, tasks, env.d.loader);
+            assert(exec.end() == vk::Result::eSuccess);
+            registry.reset(frame);
+        }
+
+        std::atomic<u32> runs{0};
+        acul::unique_function<void(u32)> job = [&runs](u32 worker) { runs += 1u << (worker * 8); };
+        registry.run_workers(3, job);
+        assert(runs == 0x010101);
+        registry.destroy();
+    }
+
+    // Legacy stage reduction of synchronization2 wait stages
+    {
+        using stage = vk::PipelineStageFlagBits;
+        using stage2 = vk::PipelineStageFlagBits2;
+        auto copy_and_fragment = to_legacy_stages(stage2::eCopy | stage2::eFragmentShader);
+        assert(copy_and_fragment == (stage::eTransfer | stage::eFragmentShader));
+        assert(to_legacy_stages(stage2::eIndexInput) == vk::PipelineStageFlags(stage::eVertexInput));
+        // Tessellation and geometry bits are only used when the device enabled those features
+        assert(to_legacy_stages(stage2::ePreRasterizationShaders) == vk::PipelineStageFlags(stage::eVertexShader));
+        enabled_device_features features;
+        features.tessellation_shader = true;
+        features.geometry_shader = true;
+        assert(to_legacy_stages(stage2::ePreRasterizationShaders, features) ==
+               (stage::eVertexShader | stage::eTessellationControlShader | stage::eTessellationEvaluationShader |
+                stage::eGeometryShader));
+        features.geometry_shader = false;
+        assert(!(to_legacy_stages(stage2::ePreRasterizationShaders, features) & stage::eGeometryShader));
+        assert(to_legacy_stages(stage2::eNone) == vk::PipelineStageFlags(stage::eAllCommands));
+    }
+
+    // Batched submission
+    {
+        auto &queue = env.rd.queues.graphics;
+        vk::CommandBuffer command_buffers[2];
+        primary_command_buffer_pool::handle command_buffer_ids[2];
+        queue.pool.primary.request(command_buffers, 2, command_buffer_ids);
+        for (auto command_buffer : command_buffers)
+        {
+            command_buffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
+                                 env.d.loader);
+            command_buffer.fillBuffer(dst.vk_buffer, 0, image_size, 0, env.d.loader);
+            command_buffer.end(env.d.loader);
+        }
+        vk::Fence fence;
+        u32 fence_id;
+        env.rd.fence_pool.request(&fence, 1, &fence_id);
+        assert(env.d.vk_device.resetFences(1, &fence, env.d.loader) == vk::Result::eSuccess);
+
+        submit_batch batch{env.d};
+        for (auto command_buffer : command_buffers)
+        {
+            batch_submission submission;
+            submission.add_command_buffer(command_buffer);
+            batch.add(queue, std::move(submission));
+        }
+        batch.signal_fence(queue, fence);
+        assert(batch.flush() == vk::Result::eSuccess);
+        assert(batch.stats().submissions == 2 && batch.stats().queue_submits == 1 && batch.stats().merged() == 1);
+        assert(env.d.vk_device.waitForFences(1, &fence, true, UINT64_MAX, env.d.loader) == vk::Result::eSuccess);
+        env.rd.fence_pool.release(fence_id);
+        queue.pool.primary.release(command_buffer_ids, 2);
+    }
+
+    // Fence tracking
+    {
+        auto &queue = env.rd.queues.graphics;
+        fence_tracker tracker{env.d};
+        fence_tracker::id ids[3];
+        u32 completed = 0;
+        for (auto &id : ids)
+        {
+            vk::CommandBuffer command_buffer;
+            primary_command_buffer_pool::handle command_buffer_id;
+            queue.pool.primary.request(&command_buffer, 1, &command_buffer_id);
+            command_buffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
+                                 env.d.loader);
+            command_buffer.fillBuffer(dst.vk_buffer, 0, image_size, 0, env.d.loader);
+            command_buffer.end(env.d.loader);
+            vk::Fence fence = tracker.acquire(id, [&, command_buffer_id](vk::Result res) {
+                assert(res == vk::Result::eSuccess);
+                queue.pool.primary.release(command_buffer_id);
+                ++completed;
+            });
+            vk::SubmitInfo submit_info;
+            submit_info.setCommandBufferCount(1).setPCommandBuffers(&command_buffer);
+            queue.vk_queue.submit(submit_info, fence, env.d.loader);
+        }
+        assert(tracker.size() == 3);
+        assert(tracker.wait_any(ids, 3) == vk::Result::eSuccess && completed >= 1);
+        assert(tracker.wait_all(ids, 3, UINT64_MAX, fence_wait_policy{}.set_spin_ns(0)) == vk::Result::eSuccess);
+        assert(tracker.size() == 0 && completed == 3 && tracker.completed(ids[0]));
+    }
+
+    // Async compute feeding the graphics queue
+    {
+        compute_exec compute{env.d};
+        // A compute family without graphics is preferred, so the work leaves the graphics queue when possible
+        auto families = env.d.physical_device.getQueueFamilyProperties(env.d.loader);
+        bool compute_only = std::any_of(families.begin(), families.end(), [](const vk::QueueFamilyProperties &family) {
+            auto flags = family.queueFlags;
+            return (flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics);
+        });
+        assert(compute.is_async() == compute_only && env.rd.queues.has_dedicated_compute() == compute_only);
+        if (compute_only)
+            assert(!(families[env.rd.queues.compute.family_id.value()].queueFlags & vk::QueueFlagBits::eGraphics));
+        compute.command_buffer.fillBuffer(dst.vk_buffer, 0, image_size, 0x01020304, env.d.loader);
+        // fillBuffer is a transfer write, so the release uses the transfer stage and access
+        if (compute.is_async()) buffer_ownership_barrier(compute, compute.graphics_ownership(), dst.vk_buffer);
+        exec_ticket compute_ticket = compute.end_async();
+
+        single_time_exec exec{env.d};
+        exec.wait_for(compute_ticket, vk::PipelineStageFlagBits::eTransfer);
+        if (compute.is_async()) buffer_ownership_barrier(exec, compute.graphics_ownership(), dst.vk_buffer);
+        copy_buffer(exec, env.d, dst.vk_buffer, src.vk_buffer, image_size);
+        assert(exec.end() == vk::Result::eSuccess);
+        assert(compute_ticket.wait() == vk::Result::eSuccess);
+
+        readback_queue readbacks{env.d};
+        single_time_exec read_exec{env.d};
+        auto result = readbacks.read_buffer(read_exec, src.vk_buffer, image_size);
+        readbacks.submit(read_exec);
+        readbacks.flush();
+        auto data = result.get();
+        assert(data.result == vk::Result::eSuccess && data.data.size() == image_size);
+        const u32 *values = reinterpret_cast<const u32 *>(data.data.data());
+        assert(std::all_of(values, values + image_size / sizeof(u32), [](u32 v) { return v == 0x01020304; }));
+    }
+
+    // Streaming upload in chunks smaller than the payload
+    {
+        acul::vector<u32> payload(image_size / sizeof(u32));
+        for (size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<u32>(i);
+        stream_upload_info upload_info;
+        upload_info.set_source(make_mapped_stream_source(payload.data(), image_size))
+            .set_chunk_size(image_size / 4 + 4)
+            .set_read_ahead(2);
+        upload_info.on_copy_chunk = make_stream_buffer_callback(dst);
+        u32 uploaded = 0;
+        upload_info.on_upload = [&uploaded](single_time_exec &) { ++uploaded; };
+        assert(stream_to_gpu(upload_info, env.d) && uploaded == 1);
+
+        buffer readback;
+        readback.instance_count = 1;
+        construct_buffer(readback, image_size);
+        assert(allocate_buffer(readback,
+                               make_alloc_info(VMA_MEMORY_USAGE_GPU_TO_CPU, vk::MemoryPropertyFlagBits::eHostVisible,
+                                               {}, 0.5f),
+                               vk::BufferUsageFlagBits::eTransferDst, env.d));
+        assert(map_buffer(readback, env.d));
+        copy_buffer(env.d, dst.vk_buffer, readback.vk_buffer, image_size);
+        invalidate_buffer(readback, env.d);
+        assert(memcmp(readback.mapped, payload.data(), image_size) == 0);
+        destroy_buffer(readback, env.d);
+
+        // Async readback of the streamed payload
+        readback_queue readbacks{env.d};
+        single_time_exec exec{env.d};
+        bool delivered = false;
+        assert(readbacks.read_buffer(exec, dst.vk_buffer, image_size, 0,
+                                     [&](vk::Result res, const void *data, vk::DeviceSize size) {
+                                         assert(res == vk::Result::eSuccess && size == image_size);
+                                         delivered = memcmp(data, payload.data(), size) == 0;
+                                     }));
+        auto tail = readbacks.read_buffer(exec, dst.vk_buffer, sizeof(u32), image_size - sizeof(u32));
+        assert(readbacks.size() == 2);
+        assert(readbacks.submit(exec).wait() == vk::Result::eSuccess);
+        assert(readbacks.collect() == 2 && readbacks.size() == 0 && delivered);
+        auto tail_result = tail.get();
+        assert(tail_result.result == vk::Result::eSuccess && tail_result.data.size() == sizeof(u32));
+        assert(memcmp(tail_result.data.data(), &payload.back(), sizeof(u32)) == 0);
+
+        stream_upload_info empty_info;
+        empty_info.on_copy_chunk = make_stream_buffer_callback(dst);
+        assert(!stream_to_gpu(empty_info, env.d));
+    }
+
+    // Batched uploads: the payload is staged by add(), each upload needs its own staging range
+    {
+        const vk::DeviceSize slice = image_size / 4;
+        const size_t slice_count = slice / sizeof(u32);
+        acul::vector<u32> expected(image_size / sizeof(u32));
+        for (size_t i = 0; i < expected.size(); ++i) expected[i] = static_cast<u32>(i * 7 + 1);
+
+        buffer external;
+        assert(create_staging_buffer(external, slice * 2, env.d));
+        buffer ranges[2] = {external, external};
+        ranges[1].offset = slice;
+        buffer overlapping = external;
+        overlapping.offset = slice / 2;
+
+        transfer_batch batch{env.d};
+        acul::vector<u32> payload(slice_count);
+        for (u32 i = 0; i < 4; ++i)
+        {
+            memcpy(payload.data(), expected.data() + i * slice_count, slice);
+            gpu_upload_info upload_info;
+            upload_info.allocation = dst.allocation;
+            upload_info.size = slice;
+            upload_info.data = payload.data();
+            if (i >= 2)
+            {
+                buffer &range = ranges[i - 2];
+                upload_info.staging = &range;
+                upload_info.on_staging_request = [&range](void *data, vk::DeviceSize size) {
+                    memcpy(static_cast<char *>(range.mapped) + range.offset, data, size);
+                    return true;
+                };
+            }
+            upload_info.on_copy_staging = [&env, &dst, slice, i](single_time_exec &exec, buffer &staging) {
+                copy_buffer(exec, env.d, staging.vk_buffer, dst.vk_buffer, slice, staging.offset, i * slice);
+            };
+            assert(batch.add(std::move(upload_info)));
+            // The batch has consumed the payload, reusing it must not affect the pending uploads
+            std::fill(payload.begin(), payload.end(), 0u);
+        }
+
+        gpu_upload_info rejected;
+        rejected.allocation = dst.allocation;
+        rejected.size = slice;
+        rejected.data = payload.data();
+        rejected.staging = &overlapping;
+        rejected.on_staging_request = [](void *, vk::DeviceSize) {
+            assert(false && "an overlapping staging range must be rejected before it is written");
+            return true;
+        };
+        assert(!batch.add(std::move(rejected)) && batch.size() == 4);
+        assert(batch.submit().wait() == vk::Result::eSuccess && batch.empty());
+        destroy_buffer(external, env.d);
+
+        readback_queue readbacks{env.d};
+        single_time_exec exec{env.d};
+        auto result = readbacks.read_buffer(exec, dst.vk_buffer, image_size);
+        assert(readbacks.submit(exec).wait() == vk::Result::eSuccess);
+        readbacks.flush();
+        auto data = result.get();
+        assert(data.result == vk::Result::eSuccess && data.data.size() == image_size);
+        assert(memcmp(data.data.data(), expected.data(), image_size) == 0);
+    }
+
     // get_alignment
     size_t aligned = get_alignment(20, 16);
     assert(aligned % 16 == 0 && aligned >= 20);
@@ -62,6 +337,19 @@ void test_utils()
     // Copy image -> buffer
     copy_image_to_buffer(env.d, dst.vk_buffer, image, {width, height}, 1);
 
+    // Async image readback, delivered by flush()
+    {
+        readback_queue readbacks{env.d};
+        single_time_exec exec{env.d};
+        readback_image_info info;
+        info.set_image(image, vk::ImageLayout::eTransferSrcOptimal).set_region({width, height, 1});
+        auto pixels = readbacks.read_image(exec, info);
+        readbacks.submit(exec);
+        readbacks.flush();
+        auto result = pixels.get();
+        assert(result.result == vk::Result::eSuccess && result.data.size() == image_size);
+    }
+
     // Clear
     destroy_buffer(src, env.d);
     destroy_buffer(dst, env.d);
@@ -1,3 +1,4 @@
+#include <agrb/retire.hpp>
 #include <agrb/vector.hpp>
 #include <numeric>
 #include "env.hpp"
@@ -153,6 +154,41 @@ void test_vector_iterators(device &d)
     assert(*it == 13);
 }
 
+void test_vector_device_address(device &d)
+{
+    if (!d.rd->features.buffer_device_address) return;
+    managed_buffer b;
+    b.buffer_usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+    b.vma_usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    b.required_flags = vk::MemoryPropertyFlagBits::eHostVisible;
+    b.instance_count = 1;
+    vector<u32> v(d, b, 1);
+    vk::DeviceAddress address = v.device_address();
+    assert(address != 0);
+    assert(v.reserve(64));
+    assert(v.device_address() != 0 && v.device_address() != address);
+}
+
+void test_vector_dirty_ranges(device &d)
+{
+    retire_queue retire{d};
+    managed_buffer b;
+    b.buffer_usage = vk::BufferUsageFlagBits::eStorageBuffer;
+    b.vma_usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+    b.required_flags = vk::MemoryPropertyFlagBits::eHostVisible;
+    b.instance_count = 1;
+    {
+        vector<u32> v(d, b, 0);
+        v.set_retire_queue(&retire);
+        track_dirty_ranges(v.data(), d);
+        // Every reallocation retires the old buffer and gives the new one a tracker of its own
+        for (u32 i = 0; i < 100; ++i) v.push_back(i);
+        assert(v.data().dirty_ranges);
+        assert(flush_dirty_ranges(d, v.data()) == vk::Result::eSuccess);
+    }
+    retire.flush();
+}
+
 void test_vector()
 {
     init_library();
@@ -166,5 +202,12 @@ void test_vector()
     test_vector_insert_erase(env.d);
     test_vector_assign(env.d);
     test_vector_iterators(env.d);
+    test_vector_dirty_ranges(env.d);
+    destroy_device(env.d);
+
+    Enviroment bda_env;
+    init_environment(bda_env, true);
+    test_vector_device_address(bda_env.d);
+    destroy_device(bda_env.d);
     destroy_library();
 }
\ No newline at end of file